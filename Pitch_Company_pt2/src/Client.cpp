@@ -4,6 +4,12 @@
 using namespace std;
 
 /*CLIENT*/
+ChangeList<Client> Client::changed;
+
+Client::Client(unsigned int nif) {
+    this->nif = nif;
+}
+
 Client::Client(string name, unsigned int nif, string date) {
     this->name = name;
     this->nif = nif;
@@ -17,13 +23,17 @@ Client::Client(string name, unsigned int nif, Date date) {
     firstLift = date;
 }
 
+Client::~Client() {
+    markSaved();
+}
+
 string Client::show() {
     stringstream info;
     info << "NIF: " << nif << " | NAME: " << name << " | NUMBER OF LIFTS: " << lifts.size();
     return info.str();
 }
 
-void Client::printToFile(ofstream &op) {
+void Client::printToFile(FileWriter &op) {
     op << name << '\n'
        << nif << '\n'
        << firstLift << '\n';
@@ -32,7 +42,7 @@ void Client::printToFile(ofstream &op) {
         op << (*it)->getCode() << "\n";
     }
     op << "####################\n";
-    op << endl;
+    op << '\n';
 }
 
 string Client::getName() const {
@@ -53,6 +63,42 @@ vector<Lift *> Client::getLifts() {
 
 void Client::purchaseNewLift(Lift *lift) {
     lifts.push_back(lift);
+    markChanged();
+}
+
+void Client::removeLift(Lift *lift) {
+    for (vector<Lift *>::iterator it = lifts.begin(); it != lifts.end(); it++) {
+        if (*it == lift) {
+            lifts.erase(it);
+            markChanged();
+            break;
+        }
+    }
+}
+
+bool Client::isDirty() const {
+    return dirty;
+}
+
+void Client::markChanged() {
+    if (dirty)
+        return;
+    dirty = true;
+    changedEntry = changed.add(this);
+}
+
+void Client::markSaved() {
+    if (!dirty)
+        return;
+    changed.remove(changedEntry);
+    dirty = false;
+}
+
+void Client::takeChanged(vector<Client *> &taken) {
+    size_t first = taken.size();
+    changed.take(taken);
+    for (size_t i = first; i < taken.size(); i++)
+        taken[i]->dirty = false;
 }
 
 bool Client::hasLifts() const {
@@ -79,7 +125,7 @@ string ParticularClient::show() {
     return info.str();
 }
 
-void ParticularClient::printToFile(ofstream &op) {
+void ParticularClient::printToFile(FileWriter &op) {
     op << name << '\n'
        << nif << '\n'
        << firstLift << '\n';
@@ -88,7 +134,7 @@ void ParticularClient::printToFile(ofstream &op) {
         op << (*it)->getCode() << "\n";
     }
     op << "####################\n";
-    op << endl;
+    op << '\n';
 }
 
 
@@ -109,7 +155,7 @@ string Entrepreneur::show() {
     return info.str();
 }
 
-void Entrepreneur::printToFile(ofstream &op) {
+void Entrepreneur::printToFile(FileWriter &op) {
     op << name << '\n'
        << nif << '\n'
        << firstLift << '\n';
@@ -119,7 +165,7 @@ void Entrepreneur::printToFile(ofstream &op) {
         op << (*it)->getCode() << "\n";
     }
     op << "####################\n";
-    op << endl;
+    op << '\n';
 }
 
 unsigned int Entrepreneur::getEmployeeNif() const {
@@ -128,6 +174,7 @@ unsigned int Entrepreneur::getEmployeeNif() const {
 
 void Entrepreneur::associateEmployee(unsigned int employeeNif) {
     this->employeeNif = employeeNif;
+    markChanged();
 }
 
 ostream &operator<<(ostream &out, Client *c) {
@@ -15,14 +15,25 @@ protected:
     unsigned int nif;
     Date firstLift;
     vector<Lift *> lifts;
+    bool dirty = false; /** changed since it was last saved, and so in changed */
+    ChangeList<Client>::Entry changedEntry; /** position in changed, while dirty */
+    static ChangeList<Client> changed; /** clients changed since the last save */
 public:
     Client() = default;
 
+    /**
+     * Constructor used to build a lookup key for the clients hash table
+     * @param nif NIF of the client to be searched
+     */
+    explicit Client(unsigned int nif);
+
     Client(string name, unsigned int nif, string date);
 
     Client(string name, unsigned int nif, Date date);
 
-    virtual ~Client() = default;
+    Client(const Client &) = delete;
+
+    virtual ~Client();
 
     /**
     * @return string containing the relevant information about the client
@@ -33,7 +44,7 @@ public:
      * Sends to the output file stream, given as parameter, information about the client respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    virtual void printToFile(ofstream &op);
+    virtual void printToFile(FileWriter &op);
 
     /**
      * @return name of the client
@@ -66,6 +77,33 @@ public:
      */
     void purchaseNewLift(Lift *lift);
 
+    /**
+     * Removes a lift from the vector of lifts bought by the client
+     * @param lift pointer to the lift to be removed
+     */
+    void removeLift(Lift *lift);
+
+    /**
+     * @return true if the client changed since it was last saved
+     */
+    bool isDirty() const;
+
+    /**
+     * Marks the client as changed since the last save, adding it to the ones the next save visits
+     */
+    void markChanged();
+
+    /**
+     * Marks the client as saved, until a lift is purchased or removed or another employee is associated
+     */
+    void markSaved();
+
+    /**
+     * Takes out every client changed since the last save, marking them as saved
+     * @param taken gets them
+     */
+    static void takeChanged(vector<Client *> &taken);
+
     bool operator==(Client *comp);
 
     bool operator<(Client *comp);
@@ -94,7 +132,7 @@ public:
      * Sends to the output file stream, given as parameter, information about the Entrepreneur respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToFile(ofstream &op);
+    void printToFile(FileWriter &op);
 
     /**
      * @return NIF of the employee associated to the entrepreneur
@@ -129,7 +167,7 @@ public:
      * Sends to the output file stream, given as parameter, information about the particular client respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToFile(ofstream &op);
+    void printToFile(FileWriter &op);
 };
 
 /** output operator for objects of the class Client */
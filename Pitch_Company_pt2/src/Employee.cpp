@@ -5,6 +5,8 @@ using namespace std;
 
 /* -------------------- EMPLOYEE -------------------- */
 
+ChangeList<Employee> Employee::changed;
+
 Employee::Employee(string name, unsigned int nif, unsigned int age) {
     this->name = name;
     this->nif = nif;
@@ -14,6 +16,10 @@ Employee::Employee(string name, unsigned int nif, unsigned int age) {
     numReviews = 0;
 }
 
+Employee::~Employee() {
+    markSaved();
+}
+
 string Employee::show() {
     stringstream info;
     info << "NIF: " << nif << '\n'
@@ -23,17 +29,25 @@ string Employee::show() {
     return info.str();
 }
 
-void Employee::printToFile(ofstream &op) {
+void Employee::printToFile(FileWriter &op) {
     op << name << '\n'
        << nif << '\n'
        << age << '\n'
        << evaluation << " " << numReviews << '\n';
 }
 
+string Employee::getName() const {
+    return name;
+}
+
 unsigned int Employee::getNif() const {
     return nif;
 }
 
+unsigned int Employee::getAge() const {
+    return age;
+}
+
 unsigned int Employee::getEvaluation() const {
     return evaluation;
 }
@@ -49,12 +63,39 @@ void Employee::setOldReviews(unsigned int eva, unsigned int nR) {
         eva = 5;
     this->evaluation = eva;
     this->numReviews = nR;
+    markChanged();
 }
 
 void Employee::review(unsigned int punctuation) {
     evaluation = (evaluation * numReviews) + punctuation;
     numReviews++;
     evaluation = evaluation / numReviews;
+    markChanged();
+}
+
+bool Employee::isDirty() const {
+    return dirty;
+}
+
+void Employee::markChanged() {
+    if (dirty)
+        return;
+    dirty = true;
+    changedEntry = changed.add(this);
+}
+
+void Employee::markSaved() {
+    if (!dirty)
+        return;
+    changed.remove(changedEntry);
+    dirty = false;
+}
+
+void Employee::takeChanged(vector<Employee *> &taken) {
+    size_t first = taken.size();
+    changed.take(taken);
+    for (size_t i = first; i < taken.size(); i++)
+        taken[i]->dirty = false;
 }
 
 bool Employee::operator<(Employee *comp) {
@@ -80,7 +121,7 @@ bool Employee::operator==(Employee *comp) {
 ServiceProvider::ServiceProvider(string name, unsigned int nif, unsigned int age, double perHourSalary, unsigned int numMaintenances) : Employee(name, nif, age) {
     function = "maintenance";
     hoursWorked = 0;
-    numMaintenances = 0;
+    this->numMaintenances = numMaintenances;
     this->perHourSalary = perHourSalary;
 }
 
@@ -96,22 +137,21 @@ string ServiceProvider::show() {
     return info.str();
 }
 
-void ServiceProvider::printToFile(ofstream &op) {
+void ServiceProvider::printToFile(FileWriter &op) {
     op << name << '\n'
        << nif << '\n'
        << age << '\n'
        << evaluation << " " << numReviews << '\n'
-       << "+\n"
-       << setprecision(3) << perHourSalary << " " << setprecision(2) << hoursWorked << " " << numMaintenances << '\n';
+       << "+\n";
+    op.putDouble(perHourSalary, 3) << " ";
+    op.putDouble(hoursWorked, 2) << " " << numMaintenances << '\n';
     if (schedule.empty()) {
         op << "--------------------\n--------------------\n";
     } else { //prints service provider schedule
-        heapMaint aux = schedule;
         op << "--------------------\n";
-        while (!aux.empty()) {
-            aux.top()->printToEmployeesFile(op);
+        for (Agenda::const_iterator it = schedule.begin(); it != schedule.end(); it++) {
+            (*it)->printToEmployeesFile(op);
             op << '\n';
-            aux.pop();
         }
         op << "--------------------\n";
     }
@@ -122,11 +162,19 @@ double ServiceProvider::getSalary() const {
     return (perHourSalary * hoursWorked);
 }
 
+double ServiceProvider::getPerHourSalary() const {
+    return perHourSalary;
+}
+
+double ServiceProvider::getHoursWorked() const {
+    return hoursWorked;
+}
+
 unsigned int ServiceProvider::getNumAppointments() const {
     return schedule.size();
 }
 
-heapMaint ServiceProvider::getSchedule() const {
+const Agenda &ServiceProvider::getSchedule() const {
     return schedule;
 }
 
@@ -136,21 +184,64 @@ int ServiceProvider::getNumMaintenancesDone() const {
 
 void ServiceProvider::setHoursWorked(double h) {
     hoursWorked = h;
+    markChanged();
 }
 
 void ServiceProvider::setNumMaintenances(unsigned int num) {
     numMaintenances = num;
+    markChanged();
+}
+
+void ServiceProvider::attachCalendar(SlotCalendar *calendar) {
+    detachCalendar();
+    this->calendar = calendar;
+    column = calendar->addColumn();
+    for (Agenda::const_iterator it = schedule.begin(); it != schedule.end(); it++)
+        calendar->book(column, *it);
+}
+
+void ServiceProvider::detachCalendar() {
+    if (calendar != NULL)
+        calendar->removeColumn(column, schedule);
+    calendar = NULL;
+}
+
+unsigned int ServiceProvider::getCalendarColumn() const {
+    return column;
+}
+
+bool ServiceProvider::isAvailable(Timestamp start) const {
+    if (calendar != NULL && !calendar->isBusyAt(column, start))
+        return true;
+    if (calendar != NULL && calendar->isSurelyBusyAt(column, start))
+        return false;
+    //two maintenances overlap when they start less than a duration apart, touching ends included
+    Agenda::const_iterator it = schedule.from(start - MAINTDURATION_SECONDS);
+    return it == schedule.end() || (*it)->getStart() > start + MAINTDURATION_SECONDS;
 }
 
 bool ServiceProvider::scheduleMaintenance(Maintenance *m) {
-    schedule.push(m);
+    if (schedule.insert(m) && calendar != NULL)
+        calendar->book(column, m);
+    markChanged();
     return true;
 }
 
-void ServiceProvider::executeMaintenance() {
+bool ServiceProvider::cancelMaintenance(Maintenance *m) {
+    if (!schedule.cancel(m))
+        return false;
+    if (calendar != NULL)
+        calendar->release(column, m, schedule);
+    markChanged();
+    return true;
+}
+
+void ServiceProvider::executeMaintenance(Maintenance *m) {
     hoursWorked += MAINTDURATION;
     numMaintenances++;
-    schedule.pop();
+    if (schedule.cancel(m) && calendar != NULL)
+        calendar->release(column, m, schedule);
+    markChanged();
 }
 
 bool ServiceProvider::operator<(Employee *comp) {
@@ -190,6 +281,10 @@ ServiceProvider * ServiceProviderType::getServiceProvider() const {
     return sp;
 }
 
+unsigned int ServiceProviderType::getNif() const {
+    return sp->getNif();
+}
+
 bool ServiceProviderType::operator<(const ServiceProviderType toCmp) const {
     if (sp->getNumMaintenancesDone() > toCmp.getServiceProvider()->getNumMaintenancesDone()) return true;
     else if (sp->getNumMaintenancesDone() == toCmp.getServiceProvider()->getNumMaintenancesDone() && sp->getEvaluation() < toCmp.getServiceProvider()->getEvaluation()) return true;
@@ -222,13 +317,13 @@ string ContractedEmployee::show() {
     return info.str();
 }
 
-void ContractedEmployee::printToFile(ofstream &op) {
+void ContractedEmployee::printToFile(FileWriter &op) {
     op << name << '\n'
        << nif << '\n'
        << age << '\n'
        << evaluation << " " << numReviews << '\n'
-       << "x\n"
-       << setprecision(4) << perMonthSalary << "\n";
+       << "x\n";
+    op.putDouble(perMonthSalary, 4) << "\n";
     if (clientsAssociated.size() == 0) {
         op << 0;
     } else {
@@ -244,18 +339,24 @@ unsigned int ContractedEmployee::getNumClientsAssociated() const {
     return clientsAssociated.size();
 }
 
+double ContractedEmployee::getPerMonthSalary() const {
+    return perMonthSalary;
+}
+
 vector<Client *> ContractedEmployee::getClientsAssociated() {
     return clientsAssociated;
 }
 
 void ContractedEmployee::associateToClient(Client *c) {
     clientsAssociated.push_back(c);
+    markChanged();
 }
 
 void ContractedEmployee::removeClient(Client *rm) {
     for (vector<Client *>::iterator it = clientsAssociated.begin(); it != clientsAssociated.end(); it++) {
         if (*it == rm) {
             clientsAssociated.erase(it);
+            markChanged();
             break;
         }
     }
@@ -298,6 +399,10 @@ ContractedEmployee * ContractedEmployeeType::getContractedEmployee() const {
     return ce;
 }
 
+unsigned int ContractedEmployeeType::getNif() const {
+    return ce->getNif();
+}
+
 bool ContractedEmployeeType::operator<(const ContractedEmployeeType toCmp) const {
     if (ce->getEvaluation() < toCmp.getContractedEmployee()->getEvaluation()) return true;
     else if (ce->getEvaluation() == toCmp.getContractedEmployee()->getEvaluation() && ce->getNumClientsAssociated() > toCmp.getContractedEmployee()->getNumClientsAssociated()) return true;
@@ -310,6 +415,29 @@ bool ContractedEmployeeType::operator==(const ContractedEmployeeType toCmp) cons
 
 
 
+/* -------------------- CONTRACTED EMPLOYEE LOAD TYPE -------------------- */
+
+ContractedEmployeeLoadType::ContractedEmployeeLoadType(ContractedEmployee *ce) {
+    this->ce = ce;
+}
+
+ContractedEmployee * ContractedEmployeeLoadType::getContractedEmployee() const {
+    return ce;
+}
+
+unsigned int ContractedEmployeeLoadType::getNif() const {
+    return ce->getNif();
+}
+
+bool ContractedEmployeeLoadType::operator<(const ContractedEmployeeLoadType toCmp) const {
+    //more clients means lower priority, ties are broken by NIF so the choice does not depend on the heap layout
+    if (ce->getNumClientsAssociated() > toCmp.getContractedEmployee()->getNumClientsAssociated()) return true;
+    else if (ce->getNumClientsAssociated() == toCmp.getContractedEmployee()->getNumClientsAssociated() && ce->getNif() > toCmp.getNif()) return true;
+    return false;
+}
+
+
+
 
 ostream &operator<<(ostream &out, Employee *e) {
     out << e->show();
@@ -2,13 +2,12 @@
 #define EMPLOYEE_H
 
 #include "Client.h"
+#include "SlotCalendar.h"
 #include <queue>
 #include <stack>
 
 using namespace std;
 
-typedef priority_queue<Maintenance *> heapMaint;
-
 /**
  * @class Employee
  */
@@ -20,10 +19,15 @@ protected:
     string function;
     unsigned int evaluation; /** can be 1, 2, 3, 4, or 5 */
     unsigned int numReviews; /** number of reviews given to the employee */
+    bool dirty = false; /** changed since it was last saved, and so in changed */
+    ChangeList<Employee>::Entry changedEntry; /** position in changed, while dirty */
+    static ChangeList<Employee> changed; /** employees changed since the last save */
 public:
     Employee(string name, unsigned int nif, unsigned int age);
 
-    virtual ~Employee() = default;
+    Employee(const Employee &) = delete;
+
+    virtual ~Employee();
 
     /**
      * @return string containing the relevant information about the employee
@@ -34,13 +38,23 @@ public:
      * Sends to the output file stream given as parameter information about the employee respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    virtual void printToFile(ofstream &op);
+    virtual void printToFile(FileWriter &op);
+
+    /**
+     * @return name of the employee
+     */
+    string getName() const;
 
     /**
      * @return NIF of the employee
      */
     unsigned int getNif() const;
 
+    /**
+     * @return age of the employee
+     */
+    unsigned int getAge() const;
+
     /**
      * @return evaluation of the employee
      */
@@ -64,6 +78,27 @@ public:
      */
     void review(unsigned int punctuation);
 
+    /**
+     * @return true if the employee changed since it was last saved
+     */
+    bool isDirty() const;
+
+    /**
+     * Marks the employee as changed since the last save, adding it to the ones the next save visits
+     */
+    void markChanged();
+
+    /**
+     * Marks the employee as saved, until a review, a maintenance or a client changes him again
+     */
+    void markSaved();
+
+    /**
+     * Takes out every employee changed since the last save, marking them as saved
+     * @param taken gets them
+     */
+    static void takeChanged(vector<Employee *> &taken);
+
     virtual bool operator<(Employee *comp);
 
     virtual bool operator==(Employee *comp);
@@ -78,7 +113,9 @@ private:
     double perHourSalary;
     double hoursWorked;
     unsigned int numMaintenances;
-    heapMaint schedule;
+    Agenda schedule; /** appointments still to be executed, earliest first */
+    SlotCalendar *calendar = NULL; /** calendar of the crew the service provider is in, kept up to date with schedule */
+    unsigned int column = 0; /** column of the service provider in calendar */
 public:
     ServiceProvider(string name, unsigned int nif, unsigned int age, double perHourSalary,
                     unsigned numMaintenances = 0);
@@ -94,13 +131,23 @@ public:
      * Sends to the output file stream given as parameter information about the service provider respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToFile(ofstream &op);
+    void printToFile(FileWriter &op);
 
     /**
      * @return total salary, given the per hour salary and the number of hours worked
      */
     double getSalary() const;
 
+    /**
+     * @return salary per hour worked
+     */
+    double getPerHourSalary() const;
+
+    /**
+     * @return number of hours worked
+     */
+    double getHoursWorked() const;
+
     /**
      * @return number of maintenances in schedule
      */
@@ -109,7 +156,7 @@ public:
     /**
      * @return schedule
      */
-    heapMaint getSchedule() const;
+    const Agenda &getSchedule() const;
 
     /**
      *
@@ -129,15 +176,45 @@ public:
      */
     void setNumMaintenances(unsigned int num);
 
+    /**
+     * Takes a column in the calendar given as parameter and marks there every appointment in the schedule, so it
+     * follows the schedule from then on
+     */
+    void attachCalendar(SlotCalendar *calendar);
+
+    /**
+     * Gives back the column taken in the calendar, clearing it
+     */
+    void detachCalendar();
+
+    /**
+     * @return column of the service provider in his calendar
+     */
+    unsigned int getCalendarColumn() const;
+
+    /**
+     * Checks whether a maintenance starting at the given moment would overlap any appointment in the schedule: right
+     * away if the calendar tells, otherwise in O(log m) for m appointments
+     * @return true if the service provider is free for the whole maintenance
+     */
+    bool isAvailable(Timestamp start) const;
+
     /**
      * Tries to schedule a maintenance, returning true if possible, meaning the service provider was available, otherwise returns false and nothing happens
      */
     bool scheduleMaintenance(Maintenance *m);
 
+    /**
+     * Takes a maintenance out of the schedule without executing it
+     * @return false if it was not in the schedule
+     */
+    bool cancelMaintenance(Maintenance *m);
+
     /**
      * Executes a maintenance request by updating the number of hours worked, the number of maintenances done and by removing that appointment from the schedule
+     * @param m appointment executed
      */
-    void executeMaintenance();
+    void executeMaintenance(Maintenance *m);
 
     bool operator<(Employee *comp);
 
@@ -159,6 +236,11 @@ public:
 
     ServiceProvider *getServiceProvider() const;
 
+    /**
+     * @return NIF of the service provider, the key by which he is found in heapEmployeesSP
+     */
+    unsigned int getNif() const;
+
     bool operator<(const ServiceProviderType toCmp) const;
 
     bool operator==(const ServiceProviderType toCmp) const;
@@ -186,13 +268,18 @@ public:
      * Sends to the output file stream given as parameter information about the contracted employee respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToFile(ofstream &op);
+    void printToFile(FileWriter &op);
 
     /**
      * @return number of clients associated with the contracted employee
      */
     unsigned int getNumClientsAssociated() const;
 
+    /**
+     * @return salary per month
+     */
+    double getPerMonthSalary() const;
+
     /**
      * @return vector containing all the clients associated to the contracted employee
      */
@@ -229,12 +316,38 @@ public:
 
     ContractedEmployee *getContractedEmployee() const;
 
+    /**
+     * @return NIF of the contracted employee, the key by which he is found in heapEmployeesCE
+     */
+    unsigned int getNif() const;
+
     bool operator<(const ContractedEmployeeType toCmp) const;
 
     bool operator==(const ContractedEmployeeType toCmp) const;
 };
 
 
+/**
+ * @class ContractedEmployeeLoadType
+ * Orders the contracted employees so that the one with less clients associated is on top of a heap
+ */
+class ContractedEmployeeLoadType {
+private:
+    ContractedEmployee *ce;
+public:
+    ContractedEmployeeLoadType(ContractedEmployee *ce);
+
+    ContractedEmployee *getContractedEmployee() const;
+
+    /**
+     * @return NIF of the contracted employee, the key by which he is found in heapEmployeesLoad
+     */
+    unsigned int getNif() const;
+
+    bool operator<(const ContractedEmployeeLoadType toCmp) const;
+};
+
+
 /** output operator for objects of the class Employee */
 ostream &operator<<(ostream &out, Employee *e);
 
@@ -86,3 +86,12 @@ string InvalidNumFloors::what() {
     reason << "There can't be a lift with " << nFloors << " floors.";
     return reason.str();
 }
+
+InputFileOpeningFailed::InputFileOpeningFailed(string path) {
+    this->path = path;
+}
+string InputFileOpeningFailed::what() {
+    stringstream reason;
+    reason << "Input file " << path << " could not be opened.";
+    return reason.str();
+}
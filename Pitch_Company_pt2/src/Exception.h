@@ -84,4 +84,15 @@ public:
     string what();
 };
 
+/**
+ * @class InputFileOpeningFailed
+ */
+class InputFileOpeningFailed {
+private:
+    string path;
+public:
+    InputFileOpeningFailed(string path);
+    string what();
+};
+
 #endif
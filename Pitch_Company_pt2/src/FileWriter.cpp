@@ -0,0 +1,144 @@
+#include "FileWriter.h"
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+/** digits of x written backwards from end, returns where they start */
+static char *formatUnsigned(unsigned int x, char *end) {
+    do {
+        *--end = (char) ('0' + x % 10);
+        x /= 10;
+    } while (x != 0);
+    return end;
+}
+
+
+FileWriter::FileWriter() : file(NULL), buffer(NULL), used(0), written(0), failed(false) {}
+
+FileWriter::~FileWriter() {
+    close();
+    free(buffer);
+}
+
+bool FileWriter::open(const string &path) {
+    close();
+    if (buffer == NULL)
+        buffer = (char *) malloc(FILEWRITERBUFFERBYTES);
+    used = 0;
+    written = 0;
+    file = buffer == NULL ? NULL : fopen(path.c_str(), "w"); //text mode, as the ofstream the files used to be written with
+    failed = file == NULL;
+    return !failed;
+}
+
+bool FileWriter::close() {
+    if (file == NULL)
+        return !failed;
+    flush();
+    if (fclose(file) != 0)
+        failed = true;
+    file = NULL;
+    return !failed;
+}
+
+bool FileWriter::fail() const {
+    return failed;
+}
+
+uint64_t FileWriter::size() const {
+    return written + used;
+}
+
+void FileWriter::flush() {
+    if (used == 0)
+        return;
+    if (file == NULL || fwrite(buffer, 1, used, file) != used)
+        failed = true;
+    written += used;
+    used = 0;
+}
+
+void FileWriter::reserve(size_t n) {
+    if (FILEWRITERBUFFERBYTES - used < n)
+        flush();
+}
+
+void FileWriter::append(const char *s, size_t n) {
+    if (n > FILEWRITERBUFFERBYTES) { //too long for the buffer, written directly
+        flush();
+        if (file == NULL || fwrite(s, 1, n, file) != n)
+            failed = true;
+        written += n;
+        return;
+    }
+    reserve(n);
+    memcpy(buffer + used, s, n);
+    used += n;
+}
+
+FileWriter &FileWriter::operator<<(char c) {
+    reserve(1);
+    buffer[used++] = c;
+    return *this;
+}
+
+FileWriter &FileWriter::operator<<(const char *s) {
+    append(s, strlen(s));
+    return *this;
+}
+
+FileWriter &FileWriter::operator<<(const string &s) {
+    append(s.data(), s.size());
+    return *this;
+}
+
+FileWriter &FileWriter::operator<<(unsigned int x) {
+    char digits[16];
+    char *end = digits + sizeof(digits);
+    char *start = formatUnsigned(x, end);
+    append(start, end - start);
+    return *this;
+}
+
+FileWriter &FileWriter::operator<<(int x) {
+    char digits[16];
+    char *end = digits + sizeof(digits);
+    char *start = formatUnsigned(x < 0 ? 0u - (unsigned int) x : (unsigned int) x, end);
+    if (x < 0)
+        *--start = '-';
+    append(start, end - start);
+    return *this;
+}
+
+FileWriter &FileWriter::operator<<(const Date &d) {
+    char text[48];
+    char *end = text + sizeof(text);
+    char *start = formatUnsigned(d.year, end);
+    *--start = '/';
+    start = formatUnsigned(d.month, start);
+    *--start = '/';
+    start = formatUnsigned(d.day, start);
+    append(start, end - start);
+    return *this;
+}
+
+FileWriter &FileWriter::operator<<(const Time &t) {
+    char text[48];
+    char *end = text + sizeof(text);
+    char *start = formatUnsigned(t.seconds, end);
+    *--start = ':';
+    start = formatUnsigned(t.minutes, start);
+    *--start = ':';
+    start = formatUnsigned(t.hours, start);
+    append(start, end - start);
+    return *this;
+}
+
+FileWriter &FileWriter::putDouble(double x, int precision) {
+    char text[64];
+    int n = snprintf(text, sizeof(text), "%.*g", precision, x); //the conversion ostream itself uses
+    if (n > 0)
+        append(text, (size_t) n < sizeof(text) ? n : sizeof(text) - 1);
+    return *this;
+}
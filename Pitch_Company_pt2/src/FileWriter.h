@@ -0,0 +1,91 @@
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include "Utils.h"
+#include <cstdio>
+#include <cstdint>
+
+using namespace std;
+
+#define FILEWRITERBUFFERBYTES (1024 * 1024) /** text gathered by a FileWriter before it is written to the file */
+
+/**
+ * @class FileWriter
+ * Writes the text files of Pitch. Every field is formatted by hand straight into a large buffer, which is only written
+ * to the file when it fills up or the file is closed; the buffer is kept from one file to the next. The text is the
+ * same an ofstream would write for the same fields
+ */
+class FileWriter {
+public:
+    FileWriter();
+
+    /**
+     * Closes the file, if it is still open
+     */
+    ~FileWriter();
+
+    FileWriter(const FileWriter &) = delete;
+
+    FileWriter &operator=(const FileWriter &) = delete;
+
+    /**
+     * Creates (or empties) the file with the given path, closing the previous one if there was one
+     * @return false if the file could not be opened
+     */
+    bool open(const string &path);
+
+    /**
+     * Writes what is left in the buffer and closes the file
+     * @return false if some of the text could not be written
+     */
+    bool close();
+
+    /**
+     * @return true if opening or writing the file failed
+     */
+    bool fail() const;
+
+    /**
+     * @return bytes written to the file since it was opened, including the ones still in the buffer
+     */
+    uint64_t size() const;
+
+    FileWriter &operator<<(char c);
+
+    FileWriter &operator<<(const char *s);
+
+    FileWriter &operator<<(const string &s);
+
+    FileWriter &operator<<(unsigned int x);
+
+    FileWriter &operator<<(int x);
+
+    /** writes the date as day/month/year */
+    FileWriter &operator<<(const Date &d);
+
+    /** writes the time as hours:minutes:seconds */
+    FileWriter &operator<<(const Time &t);
+
+    /**
+     * Writes x with at most the given number of significant digits, as an ofstream with that precision does
+     */
+    FileWriter &putDouble(double x, int precision);
+
+private:
+    FILE *file;
+    char *buffer;
+    size_t used;
+    uint64_t written;
+    bool failed;
+
+    /**
+     * Writes the buffer to the file if less than n bytes are free in it
+     */
+    void reserve(size_t n);
+
+    void flush();
+
+    void append(const char *s, size_t n);
+};
+
+#endif
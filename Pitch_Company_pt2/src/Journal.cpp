@@ -0,0 +1,308 @@
+#include "Journal.h"
+#include "Snapshot.h"
+#include <cstring>
+
+using namespace std;
+
+/** bytes before the payload of each entry: length, type, sequence and checksum */
+#define ENTRYHEADERSIZE 20
+
+static uint32_t checksum(uint32_t type, uint64_t sequence, const char *payload, size_t length) {
+    uint32_t h = 2166136261u; //FNV-1a
+    uint64_t fields[2] = {type, sequence};
+    const unsigned char *p = (const unsigned char *) fields;
+    for (size_t i = 0; i < sizeof(fields); i++)
+        h = (h ^ p[i]) * 16777619u;
+    p = (const unsigned char *) payload;
+    for (size_t i = 0; i < length; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+
+JournalEntry::JournalEntry(unsigned int type) : type(type), sequence(0), cursor(0) {}
+
+unsigned int JournalEntry::getType() const {
+    return type;
+}
+
+uint64_t JournalEntry::getSequence() const {
+    return sequence;
+}
+
+JournalEntry &JournalEntry::putUnsigned(uint32_t x) {
+    payload.append((const char *) &x, sizeof(x));
+    return *this;
+}
+
+JournalEntry &JournalEntry::putInt(int32_t x) {
+    payload.append((const char *) &x, sizeof(x));
+    return *this;
+}
+
+JournalEntry &JournalEntry::putDouble(double x) {
+    payload.append((const char *) &x, sizeof(x));
+    return *this;
+}
+
+JournalEntry &JournalEntry::putString(const string &s) {
+    putUnsigned(s.size());
+    payload += s;
+    return *this;
+}
+
+JournalEntry &JournalEntry::putDate(const Date &d) {
+    return putUnsigned(d.toKey());
+}
+
+JournalEntry &JournalEntry::putTime(const Time &t) {
+    return putUnsigned(t.toSeconds());
+}
+
+bool JournalEntry::read(void *to, size_t n) {
+    if (payload.size() - cursor < n) {
+        memset(to, 0, n);
+        return false;
+    }
+    memcpy(to, payload.data() + cursor, n);
+    cursor += n;
+    return true;
+}
+
+uint32_t JournalEntry::getUnsigned() {
+    uint32_t x;
+    read(&x, sizeof(x));
+    return x;
+}
+
+int32_t JournalEntry::getInt() {
+    int32_t x;
+    read(&x, sizeof(x));
+    return x;
+}
+
+double JournalEntry::getDouble() {
+    double x;
+    read(&x, sizeof(x));
+    return x;
+}
+
+string JournalEntry::getString() {
+    uint32_t length = getUnsigned();
+    if (payload.size() - cursor < length)
+        return "";
+    string s = payload.substr(cursor, length);
+    cursor += length;
+    return s;
+}
+
+Date JournalEntry::getDate() {
+    return Date::fromKey(getUnsigned());
+}
+
+Time JournalEntry::getTime() {
+    return Time::fromSeconds(getUnsigned());
+}
+
+
+Journal::Journal() : file(NULL), pendingWritten(0), lastSequence(0), fileSize(0) {}
+
+Journal::~Journal() {
+    if (file != NULL) {
+        commit();
+        fclose(file);
+    }
+}
+
+bool Journal::open(const string &path, vector<JournalEntry> &entries) {
+    lock_guard<mutex> lock(guard);
+    this->path = path;
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+    pending.clear();
+    pendingWritten = 0;
+
+    string contents;
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in != NULL) {
+        char buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            contents.append(buffer, n);
+        fclose(in);
+    }
+
+    size_t headerSize = strlen(JOURNALMAGIC) + sizeof(uint32_t);
+    uint32_t version = 0;
+    if (contents.size() >= headerSize)
+        memcpy(&version, contents.data() + strlen(JOURNALMAGIC), sizeof(version));
+    bool validHeader = contents.size() >= headerSize &&
+                       contents.compare(0, strlen(JOURNALMAGIC), JOURNALMAGIC) == 0 && version == JOURNALVERSION;
+
+    size_t valid = headerSize;
+    while (validHeader && contents.size() - valid >= ENTRYHEADERSIZE) {
+        uint32_t length, type, sum;
+        uint64_t sequence;
+        const char *p = contents.data() + valid;
+        memcpy(&length, p, 4);
+        memcpy(&type, p + 4, 4);
+        memcpy(&sequence, p + 8, 8);
+        memcpy(&sum, p + 16, 4);
+        if (contents.size() - valid - ENTRYHEADERSIZE < length ||
+            checksum(type, sequence, p + ENTRYHEADERSIZE, length) != sum)
+            break; //the last group was interrupted while being written
+        JournalEntry entry(type);
+        entry.sequence = sequence;
+        entry.payload.assign(p + ENTRYHEADERSIZE, length);
+        entries.push_back(entry);
+        lastSequence = sequence;
+        valid += ENTRYHEADERSIZE + length;
+    }
+
+    if (!validHeader) { //new journal, or one written by another version that can not be replayed
+        entries.clear();
+        if (!writeHeader(path))
+            return false;
+        fileSize = strlen(JOURNALMAGIC) + sizeof(uint32_t);
+    } else if (valid < contents.size()) { //the damaged tail is dropped so new entries are not appended after it
+        //the entries kept are on the disk before they replace the damaged journal, as in truncate
+        string tmpPath = path + ".tmp";
+        FILE *out = fopen(tmpPath.c_str(), "wb");
+        if (out == NULL)
+            return false;
+        bool written = fwrite(contents.data(), 1, valid, out) == valid;
+        written = syncFile(out) && written;
+        written = fclose(out) == 0 && written;
+        if (!written || !replaceFile(tmpPath, path)) {
+            remove(tmpPath.c_str());
+            return false;
+        }
+        fileSize = valid;
+    } else {
+        fileSize = valid;
+    }
+
+    file = fopen(path.c_str(), "ab");
+    return file != NULL;
+}
+
+/**
+ * Writes the magic and version a journal starts with
+ */
+static bool putHeader(FILE *out) {
+    uint32_t version = JOURNALVERSION;
+    return fwrite(JOURNALMAGIC, 1, strlen(JOURNALMAGIC), out) == strlen(JOURNALMAGIC) &&
+           fwrite(&version, sizeof(version), 1, out) == 1;
+}
+
+bool Journal::writeHeader(const string &to) {
+    FILE *out = fopen(to.c_str(), "wb");
+    if (out == NULL)
+        return false;
+    putHeader(out);
+    return fclose(out) == 0;
+}
+
+bool Journal::append(JournalEntry &entry) {
+    lock_guard<mutex> lock(guard);
+    entry.sequence = ++lastSequence;
+    if (pending.empty())
+        oldestPending = chrono::steady_clock::now();
+
+    uint32_t length = entry.payload.size(), type = entry.type;
+    uint32_t sum = checksum(type, entry.sequence, entry.payload.data(), length);
+    pending.append((const char *) &length, 4);
+    pending.append((const char *) &type, 4);
+    pending.append((const char *) &entry.sequence, 8);
+    pending.append((const char *) &sum, 4);
+    pending += entry.payload;
+
+    if (pending.size() >= JOURNALGROUPBYTES ||
+        chrono::steady_clock::now() - oldestPending >= chrono::milliseconds(JOURNALGROUPMS))
+        return flush();
+    return true;
+}
+
+bool Journal::commit() {
+    lock_guard<mutex> lock(guard);
+    return flush();
+}
+
+bool Journal::commitIfOld() {
+    lock_guard<mutex> lock(guard);
+    if (pending.empty() || chrono::steady_clock::now() - oldestPending < chrono::milliseconds(JOURNALGROUPMS))
+        return true;
+    return flush();
+}
+
+bool Journal::flush() {
+    if (pending.empty())
+        return true;
+    if (file == NULL)
+        return false;
+    //after a failed flush only the bytes the file did not take are written again, so no entry is there twice
+    pendingWritten += fwrite(pending.data() + pendingWritten, 1, pending.size() - pendingWritten, file);
+    if (pendingWritten < pending.size() || !syncFile(file))
+        return false; //pending is kept to be written with the next group
+    fileSize += pending.size();
+    pending.clear();
+    pendingWritten = 0;
+    return true;
+}
+
+bool Journal::truncate(uint64_t upTo) {
+    lock_guard<mutex> lock(guard);
+    if (!flush() || file == NULL)
+        return false;
+    fclose(file);
+    file = NULL;
+
+    //the entries appended after upTo are copied to the new journal
+    string kept;
+    size_t headerSize = strlen(JOURNALMAGIC) + sizeof(uint32_t);
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in != NULL) {
+        if (upTo < headerSize)
+            upTo = headerSize;
+        if (upTo < fileSize && fseek(in, (long) upTo, SEEK_SET) == 0) {
+            char buffer[65536];
+            size_t n;
+            while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+                kept.append(buffer, n);
+        }
+        fclose(in);
+    }
+
+    //the new journal is on the disk before it replaces the old one, see replaceFile
+    string tmpPath = path + ".tmp";
+    FILE *out = fopen(tmpPath.c_str(), "wb");
+    bool written = out != NULL;
+    if (written) {
+        written = putHeader(out) && fwrite(kept.data(), 1, kept.size(), out) == kept.size();
+        written = syncFile(out) && written;
+        written = fclose(out) == 0 && written;
+    }
+    written = written && replaceFile(tmpPath, path);
+    if (written)
+        fileSize = headerSize + kept.size();
+    else
+        remove(tmpPath.c_str());
+    file = fopen(path.c_str(), "ab");
+    return written && file != NULL;
+}
+
+uint64_t Journal::getLastSequence() const {
+    return lastSequence;
+}
+
+void Journal::skipTo(uint64_t seq) {
+    if (lastSequence < seq)
+        lastSequence = seq;
+}
+
+uint64_t Journal::size() const {
+    lock_guard<mutex> lock(guard);
+    return fileSize + pending.size();
+}
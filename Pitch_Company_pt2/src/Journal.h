@@ -0,0 +1,177 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Utils.h"
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+#define JOURNALMAGIC "PITCHJNL"
+#define JOURNALVERSION 1
+#define JOURNALGROUPBYTES 65536 /** pending records are written together once they reach this size... */
+#define JOURNALGROUPMS 1000 /** ...or once the oldest of them has waited this long */
+#define JOURNALCHECKPOINTBYTES (16 * 1024 * 1024) /** journal size from which Pitch compacts it into a snapshot */
+#define SNAPSHOTINTERVAL 300 /** seconds after which Pitch compacts the journal into a snapshot anyway, if it has entries */
+
+/** kinds of mutation recorded in the journal, the fields of each one are listed in Pitch::applyJournalEntry */
+enum JournalRecordType {
+    JOURNAL_MOVE = 1,
+    JOURNAL_LIFT_ADDED,
+    JOURNAL_LIFT_REMOVED,
+    JOURNAL_CLIENT_ADDED,
+    JOURNAL_CLIENT_REMOVED,
+    JOURNAL_CLIENT_ASSOCIATED,
+    JOURNAL_EMPLOYEE_ADDED,
+    JOURNAL_EMPLOYEE_REMOVED,
+    JOURNAL_EMPLOYEE_REVIEWED,
+    JOURNAL_MAINTENANCE_SCHEDULED,
+    JOURNAL_MAINTENANCE_REASSIGNED,
+    JOURNAL_MAINTENANCE_AUTOMATIC,
+    JOURNAL_MAINTENANCES_UPDATED,
+    JOURNAL_MAINTENANCE_CANCELLED
+};
+
+/**
+ * @class JournalEntry
+ * One mutation: its type and its fields, written and read back in the same order
+ */
+class JournalEntry {
+public:
+    explicit JournalEntry(unsigned int type = 0);
+
+    unsigned int getType() const;
+
+    /**
+     * @return position of the entry in the journal, assigned when it is appended
+     */
+    uint64_t getSequence() const;
+
+    JournalEntry &putUnsigned(uint32_t x);
+
+    JournalEntry &putInt(int32_t x);
+
+    JournalEntry &putDouble(double x);
+
+    JournalEntry &putString(const string &s);
+
+    JournalEntry &putDate(const Date &d);
+
+    JournalEntry &putTime(const Time &t);
+
+    /*
+     * Readers of the fields, in the order they were put; past the end of the entry they return 0 or an empty string
+     */
+    uint32_t getUnsigned();
+
+    int32_t getInt();
+
+    double getDouble();
+
+    string getString();
+
+    Date getDate();
+
+    Time getTime();
+
+private:
+    friend class Journal;
+
+    unsigned int type;
+    uint64_t sequence;
+    string payload;
+    size_t cursor;
+
+    bool read(void *to, size_t n);
+};
+
+/**
+ * @class Journal
+ * Append only file of mutations. Entries are buffered and written in groups, each one with a checksum so a group
+ * interrupted halfway is recognized and discarded when the journal is read again. Entries are appended by one thread,
+ * while another one may write the group waiting too long or truncate the journal
+ */
+class Journal {
+public:
+    Journal();
+
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+
+    Journal &operator=(const Journal &) = delete;
+
+    /**
+     * Opens the journal at path, creating it if it does not exist, and reads the entries it has
+     * @param entries filled with the entries found, in the order they were appended
+     * @return false if the file could not be opened
+     */
+    bool open(const string &path, vector<JournalEntry> &entries);
+
+    /**
+     * Numbers the entry and buffers it, writing the buffered group if it is big or old enough
+     * @return false if the group could not be written; its entries stay buffered and are tried again with the next one
+     */
+    bool append(JournalEntry &entry);
+
+    /**
+     * Writes the buffered entries and flushes them to disk
+     * @return false if they could not be written
+     */
+    bool commit();
+
+    /**
+     * commit(), if the oldest buffered entry has waited JOURNALGROUPMS; called from time to time by another thread so
+     * the last entries are written even when no other one is appended after them
+     * @return false if they could not be written
+     */
+    bool commitIfOld();
+
+    /**
+     * Drops the entries in the first bytes of the journal, once they are in a snapshot, keeping the ones appended
+     * after them; the journal is rewritten to a temporary file, forced to the disk, that then replaces it with
+     * replaceFile. Sequence numbers keep growing
+     * @param upTo size() when the last entry to drop was committed
+     * @return false if the file could not be rewritten
+     */
+    bool truncate(uint64_t upTo);
+
+    /**
+     * @return sequence number of the last entry appended
+     */
+    uint64_t getLastSequence() const;
+
+    /**
+     * Makes the next entries be numbered after seq, if it is bigger than the last sequence number in the journal
+     */
+    void skipTo(uint64_t seq);
+
+    /**
+     * @return size of the journal in bytes, counting the entries not written yet
+     */
+    uint64_t size() const;
+
+private:
+    string path;
+    FILE *file;
+    string pending;
+    size_t pendingWritten; /** bytes at the start of pending the file already took in a flush that then failed */
+    uint64_t lastSequence;
+    uint64_t fileSize;
+    chrono::steady_clock::time_point oldestPending;
+    mutable mutex guard; /** held while the file, pending or fileSize are used */
+
+    /**
+     * Writes the header of an empty journal to the given path
+     */
+    bool writeHeader(const string &to);
+
+    /**
+     * commit(), with guard already held
+     */
+    bool flush();
+};
+
+#endif
@@ -14,7 +14,7 @@
 
 using namespace std;
 
-void printMove(ofstream &op, const Moves &move) {
+void printMove(FileWriter &op, const Moves &move) {
     op << move.date << " " << move.from << " " << move.to << '\n'
        << move.tInitial;
 }
@@ -29,12 +29,15 @@ ostream &operator<<(ostream &out, Moves move)
 }
 
 unsigned int Lift::nLifts = 0;
+list<const Lift *> Lift::loadedMoves;
+unsigned int Lift::numLoadedMoves = 0;
+ChangeList<Lift> Lift::changed;
 
 Lift::Lift() {
     buildingName = "not defined";
     this->address = "not defined";
     this->capacity = 0.0;
-    code = nLifts + 100;
+    code = nLifts + FIRSTLIFTCODE;
     install = Date(0, 0, 0);
     regularTime = 0;
     clientNif = 0;
@@ -52,10 +55,26 @@ Lift::Lift(string buildingName, string address, unsigned int capacity, unsigned
     this->nFloors = nFloors;
     if (nFloors < 1)
         throw InvalidNumFloors(nFloors);
-    code = nLifts + 100;
+    code = nLifts + FIRSTLIFTCODE;
     this->install = d;
     nLifts++;
 }
+Lift::Lift(unsigned int code, string buildingName, string address, unsigned int capacity, unsigned int clientNif,
+           unsigned int nFloors, Date &d) {
+    this->buildingName = buildingName;
+    this->address = address;
+    this->capacity = capacity;
+    this->clientNif = clientNif;
+    this->nFloors = nFloors;
+    if (nFloors < 1)
+        throw InvalidNumFloors(nFloors);
+    this->code = code;
+    this->install = d;
+}
+Lift::~Lift() {
+    uncacheMoves();
+    markSaved();
+}
 
 string Lift::show() {
     stringstream info;
@@ -64,6 +83,7 @@ string Lift::show() {
          << "BUILDING NAME: " << buildingName << "\n"
          << "INSTALLATION DATE: " <<install << "\n"
          << "MAINTENANCE HISTORY: " << '\n';
+    loadMoves();
     for(unsigned int i  = 0; i < maintHistory.size();i++){
         info<< maintHistory[i]<<"\n";
     }
@@ -76,7 +96,7 @@ string Lift::show() {
     return info.str();
 }
 
-void Lift::printToFile(ofstream &op) {
+void Lift::printToFile(FileWriter &op) {
     op << clientNif << '\n'
        << buildingName << '\n'
        << address << '\n'
@@ -84,6 +104,7 @@ void Lift::printToFile(ofstream &op) {
        << capacity << " " << nFloors << " " << regularTime << '\n'
        << currentFloor << " " << higherFloor << " " << lowerFloor << '\n';
     op << "####################\n";
+    loadMoves();
     for (vector<Moves>::iterator it = movesHistory.begin(); it != movesHistory.end(); it++) {
         printMove(op, (*it));
         op << '\n';
@@ -111,6 +132,12 @@ string Lift::getAddress() const {
 Date Lift::getInstallDate() const {
     return install;
 }
+unsigned int Lift::getCapacity() const {
+    return capacity;
+}
+unsigned int Lift::getNumFloors() const {
+    return nFloors;
+}
 unsigned int Lift::getPrice() const {
     return price;
 }
@@ -124,17 +151,108 @@ int Lift::getLowerFloor() const {
     return lowerFloor;
 }
 vector<Moves> Lift::getMoves() {
+    loadMoves();
+    return movesHistory;
+}
+const vector<Moves> &Lift::getMovesHistory() const {
+    loadMoves();
     return movesHistory;
 }
+const vector<Maintenance *> &Lift::getMaintHistory() const {
+    return maintHistory;
+}
 Moves Lift::getLastMove() const {
+    loadMoves();
     return movesHistory[movesHistory.size() - 1];
 }
 int Lift::getRegularTime() const {
     return regularTime;
 }
 
+void Lift::attachMoves(const SnapshotMoveCursor &moves, unsigned int count) {
+    uncacheMoves();
+    vector<Moves>().swap(movesHistory);
+    savedMoves = moves;
+    numSavedMoves = count;
+    movesSaved = true;
+    movesLoaded = false;
+}
+void Lift::detachMoves() {
+    loadMoves();
+    uncacheMoves();
+    movesSaved = false;
+}
+bool Lift::hasSavedMoves() const {
+    return movesSaved;
+}
+void Lift::loadMoves() const {
+    if (!movesSaved)
+        return;
+    if (movesLoaded) { //already in memory, it becomes the most recently used
+        loadedMoves.splice(loadedMoves.begin(), loadedMoves, cacheEntry);
+        return;
+    }
+    SnapshotMoveCursor cursor = savedMoves;
+    movesHistory.reserve(numSavedMoves);
+    for (SnapshotMove move; cursor.next(move);)
+        movesHistory.push_back(makeMove(move.from, move.to, Date::fromKey(move.date), Time::fromSeconds(move.tInitial)));
+    if (movesHistory.size() != numSavedMoves) { //the columns are damaged, the moves read before that are kept in memory
+        cerr << "The moves of lift " << code << " in the snapshot are damaged, only " << movesHistory.size() << " of "
+             << numSavedMoves << " could be read.\n";
+        movesSaved = false;
+        return;
+    }
+    movesLoaded = true;
+    cacheEntry = loadedMoves.insert(loadedMoves.begin(), this);
+    numLoadedMoves += movesHistory.size();
+
+    while (numLoadedMoves > MOVESCACHESIZE && loadedMoves.back() != this) {
+        const Lift *evicted = loadedMoves.back();
+        evicted->uncacheMoves();
+        vector<Moves>().swap(evicted->movesHistory);
+        evicted->movesLoaded = false;
+    }
+}
+void Lift::uncacheMoves() const {
+    if (!movesSaved || !movesLoaded)
+        return;
+    loadedMoves.erase(cacheEntry);
+    numLoadedMoves -= movesHistory.size();
+}
+
+void Lift::restoreCode(unsigned int savedCode) {
+    code = savedCode;
+    if (nLifts < code - FIRSTLIFTCODE + 1)
+        nLifts = code - FIRSTLIFTCODE + 1;
+    markChanged();
+}
+bool Lift::isDirty() const {
+    return dirty;
+}
+
+void Lift::markChanged() {
+    if (dirty)
+        return;
+    dirty = true;
+    changedEntry = changed.add(this);
+}
+
+void Lift::markSaved() {
+    if (!dirty)
+        return;
+    changed.remove(changedEntry);
+    dirty = false;
+}
+
+void Lift::takeChanged(vector<Lift *> &taken) {
+    size_t first = taken.size();
+    changed.take(taken);
+    for (size_t i = first; i < taken.size(); i++)
+        taken[i]->dirty = false;
+}
 void Lift::setOwner(unsigned int nif) {
     clientNif = nif;
+    markChanged();
 }
 void Lift::setPrice() {
     if (nFloors < 3) {
@@ -169,21 +287,26 @@ void Lift::setPrice() {
 }
 void Lift::setRegularTime() {
     regularTime = rand() % 5 + 7;
+    markChanged();
 }
 void Lift::setRegularTime(int secs) {
     regularTime = secs;
+    markChanged();
 }
 void Lift::setCurrentFloor(int floor) {
     currentFloor = floor;
+    markChanged();
 }
 void Lift::setHigherFloor(int floor) {
     higherFloor = floor;
+    markChanged();
 }
 void Lift::setLowerFloor(int floor) {
     lowerFloor = floor;
+    markChanged();
 }
 
-void Lift::readMove(int from, int to, Date d, Time t) {
+Moves Lift::makeMove(int from, int to, Date d, Time t) const {
     Moves move;
     Time regTime(0, 0, regularTime);
     move.from = from;
@@ -191,14 +314,21 @@ void Lift::readMove(int from, int to, Date d, Time t) {
     move.floorCount = abs(to - from);
     move.date = d;
     move.tInitial = t;
-    move.tFinal = t + regTime * (to - from);
-    movesHistory.push_back(move);
+    move.tFinal = t + regTime * move.floorCount;
+    return move;
+}
+
+void Lift::readMove(int from, int to, Date d, Time t) {
+    detachMoves(); //the moves in memory are no longer the ones in the snapshot
+    movesHistory.push_back(makeMove(from, to, d, t));
     currentFloor = to;
     doorOpens += 2;
+    markChanged();
 }
 
 void Lift::addMaintenanceToMaintHistory(Maintenance *m){
     maintHistory.push_back(m);
+    markChanged();
 }
 bool Lift::checkMaintenanceNeeded(Date today) {
 
@@ -2,7 +2,12 @@
 #define LIFT_H
 
 #include "Maintenance.h"
+#include "Snapshot.h"
 #include <vector>
+#include <list>
+
+#define FIRSTLIFTCODE 100
+#define MOVESCACHESIZE 1048576 /** moves read from the snapshot kept in memory at most, by all the lifts together */
 
 using namespace std;
 
@@ -18,7 +23,7 @@ struct Moves {
     Time tFinal;
 };
 
-void printMove(ofstream &op, const Moves &move); /** function that prints with the correct format a move to the file */
+void printMove(FileWriter &op, const Moves &move); /** function that prints with the correct format a move to the file */
 ostream &operator<<(ostream &out, Moves move);
 
 /**
@@ -51,10 +56,42 @@ private:
     int lowerFloor;
     int previousDoorOpens = 0;
     vector<Maintenance*> maintHistory;
-    vector<Moves> movesHistory;
+    mutable vector<Moves> movesHistory;
+    SnapshotMoveCursor savedMoves = SnapshotMoveCursor(NULL, 0, 0); /** moves of the lift in the snapshot */
+    unsigned int numSavedMoves = 0;
+    mutable bool movesSaved = false; /** movesHistory is the same as savedMoves, so it can be dropped and read again */
+    mutable bool movesLoaded = true; /** movesHistory holds the moves, false after they were dropped */
+    mutable list<const Lift *>::iterator cacheEntry; /** position in loadedMoves, if movesSaved and movesLoaded */
+    bool dirty = false; /** changed since it was last saved, and so in changed */
+    ChangeList<Lift>::Entry changedEntry; /** position in changed, while dirty */
+    static ChangeList<Lift> changed; /** lifts changed since the last save */
+
+    /**
+     * Lifts whose moves were read from the snapshot and are still in memory, the most recently used first. Used only
+     * by the thread that runs the menus, lifts being built by other threads have all their moves in memory
+     */
+    static list<const Lift *> loadedMoves;
+    static unsigned int numLoadedMoves; /** moves held by the lifts in loadedMoves */
+
+    /**
+     * Makes sure movesHistory holds the moves of the lift, reading them from the snapshot if they were dropped, and
+     * drops the moves of the least recently used lifts if there are more than MOVESCACHESIZE in memory. If the moves
+     * in the snapshot are damaged, the ones read before the damage are kept in memory for good
+     */
+    void loadMoves() const;
+
+    /**
+     * Takes the lift out of loadedMoves, keeping its moves in memory
+     */
+    void uncacheMoves() const;
+
+    /**
+     * @return move from one floor to another started at the given date and time
+     */
+    Moves makeMove(int from, int to, Date d, Time t) const;
 public:
-    static unsigned int nLifts; /** static variable since the lift code equals the number of lifts plus 100 */
-    int doorOpens; /** number of door openings saved for maintenance control purposes, set again to 0 once a maintenance occurs */
+    static unsigned int nLifts; /** static variable since the lift code equals the number of lifts plus FIRSTLIFTCODE */
+    int doorOpens = 0; /** number of door openings saved for maintenance control purposes, set again to 0 once a maintenance occurs */
 
     Lift();
 
@@ -71,7 +108,18 @@ public:
     Lift(string buildingName, string address, unsigned int capacity, unsigned int clientNif, unsigned int nFloors,
          Date &d);
 
-    ~Lift() = default;
+    /**
+     * Constructor for a lift whose code was already decided, which leaves nLifts untouched so lifts can be built by
+     * several threads at once; whoever decides the codes must update nLifts
+     * @param code code of the lift
+     * @throw InvalidNumFloors
+     */
+    Lift(unsigned int code, string buildingName, string address, unsigned int capacity, unsigned int clientNif,
+         unsigned int nFloors, Date &d);
+
+    Lift(const Lift &) = delete;
+
+    ~Lift();
 
     /**
      * @return string containing the relevant information about the lift
@@ -82,7 +130,7 @@ public:
      * Sends to the output file stream given as parameter information about the lift respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToFile(ofstream &op);
+    void printToFile(FileWriter &op);
 
     /**
      * Determines whether or not the lift has had maintenance
@@ -120,6 +168,16 @@ public:
      */
     Date getInstallDate() const;
 
+    /**
+     * @return capacity of the lift
+     */
+    unsigned int getCapacity() const;
+
+    /**
+     * @return number of floors of the building
+     */
+    unsigned int getNumFloors() const;
+
     /**
      * @return price of the lift
      */
@@ -155,11 +213,66 @@ public:
      */
     vector<Moves> getMoves();
 
+    /**
+     * @return moves executed by the lift, without copying them
+     */
+    const vector<Moves> &getMovesHistory() const;
+
+    /**
+     * @return maintenances the lift has had, oldest first
+     */
+    const vector<Maintenance *> &getMaintHistory() const;
+
     /**
      * @return last move that the lift has executed
      */
     Moves getLastMove() const;
 
+    /**
+     * Replaces the moves in memory by the ones saved in a snapshot, which are only read the first time they are needed
+     * and may be dropped again when other lifts need the memory; the snapshot must stay mapped while the lift uses it
+     * @param moves cursor over the moves of the lift in the snapshot
+     * @param count number of moves
+     */
+    void attachMoves(const SnapshotMoveCursor &moves, unsigned int count);
+
+    /**
+     * Reads the moves of the lift from the snapshot for good, so it no longer needs the snapshot
+     */
+    void detachMoves();
+
+    /**
+     * @return true if the moves of the lift are the ones saved for it in the snapshot it reads them from
+     */
+    bool hasSavedMoves() const;
+
+    /**
+     * Gives the lift back the code it had when it was saved, making sure lifts created afterwards get new codes
+     * @param savedCode code of the lift when it was saved
+     */
+    void restoreCode(unsigned int savedCode);
+
+    /**
+     * @return true if the lift changed since it was last saved
+     */
+    bool isDirty() const;
+
+    /**
+     * Marks the lift as changed since the last save, adding it to the ones the next save visits
+     */
+    void markChanged();
+
+    /**
+     * Marks the lift as saved, until one of the setters, a move or a maintenance changes it again
+     */
+    void markSaved();
+
+    /**
+     * Takes out every lift changed since the last save, marking them as saved
+     * @param taken gets them
+     */
+    static void takeChanged(vector<Lift *> &taken);
+
     /**
      * @param nif NIF of the client that owns the lift
      */
@@ -1,13 +1,16 @@
 #include "Maintenance.h"
 
 Time Maintenance::duration = Time(MAINTDURATION_STR);
+unsigned int Maintenance::lastId = 0;
+ChangeList<Maintenance> Maintenance::changed;
 
-Maintenance::Maintenance() {}
+Maintenance::Maintenance() : start(0) {}
 
 Maintenance::Maintenance(unsigned int code, Date appointment, Time schedule, unsigned int spnif) {
     this->liftCode = code;
     this->appointment = appointment;
     this->schedule = schedule;
+    this->start = toTimestamp(appointment, schedule);
     this->spNIF = spnif;
     this->finished = false;
 }
@@ -16,19 +19,24 @@ Maintenance::Maintenance(unsigned int code, Date appointment, Time schedule, uns
     this->liftCode = code;
     this->appointment = appointment;
     this->schedule = schedule;
+    this->start = toTimestamp(appointment, schedule);
     this->spNIF = spnif;
     this->finished = finished;
 }
 
-void Maintenance::printToMaintsFile(ostream &op) const {
+Maintenance::~Maintenance() {
+    markSaved();
+}
+
+void Maintenance::printToMaintsFile(FileWriter &op) const {
     op << liftCode << " " << spNIF << " " << appointment << " " << schedule;
 }
 
-void Maintenance::printToLiftsFile(ostream &op) const {
+void Maintenance::printToLiftsFile(FileWriter &op) const {
     op << appointment << " " << schedule << " " << spNIF;
 }
 
-void Maintenance::printToEmployeesFile(ostream &op) const {
+void Maintenance::printToEmployeesFile(FileWriter &op) const {
     op << liftCode << " " << appointment << " " << schedule;
 }
 
@@ -40,6 +48,11 @@ unsigned int Maintenance::getSpNIF() const {
     return spNIF;
 }
 
+void Maintenance::setSpNIF(unsigned int nif) {
+    spNIF = nif;
+    markChanged();
+}
+
 Date Maintenance::getMaintenanceDate() const {
     return appointment;
 }
@@ -48,6 +61,10 @@ Time Maintenance::getMaintenanceSchedule() const {
     return schedule;
 }
 
+Timestamp Maintenance::getStart() const {
+    return start;
+}
+
 Time Maintenance::getMaintenanceDuration() const {
     return duration;
 }
@@ -58,19 +75,58 @@ bool Maintenance::getFinished() const {
 
 void Maintenance::setFinished(bool value) {
     finished = value;
+    markChanged();
+}
+
+unsigned int Maintenance::getId() const {
+    return id;
+}
+
+void Maintenance::assignId() {
+    if (id == 0)
+        id = ++lastId;
+}
+
+void Maintenance::restoreId(unsigned int savedId) {
+    id = savedId;
+    if (lastId < id)
+        lastId = id;
+    markChanged();
+}
+
+bool Maintenance::isDirty() const {
+    return dirty;
+}
+
+void Maintenance::markChanged() {
+    if (dirty)
+        return;
+    dirty = true;
+    changedEntry = changed.add(this);
+}
+
+void Maintenance::markSaved() {
+    if (!dirty)
+        return;
+    changed.remove(changedEntry);
+    dirty = false;
+}
+
+void Maintenance::takeChanged(vector<Maintenance *> &taken) {
+    size_t first = taken.size();
+    changed.take(taken);
+    for (size_t i = first; i < taken.size(); i++)
+        taken[i]->dirty = false;
 }
 
 bool Maintenance::operator<(const Maintenance &m) const {
-    if (appointment == m.appointment) {
-        if (schedule == m.schedule) {
-            if (liftCode == m.liftCode) {
-                return spNIF < m.spNIF;
-            }
-            return liftCode < m.liftCode;
+    if (start == m.start) {
+        if (liftCode == m.liftCode) {
+            return spNIF < m.spNIF;
         }
-        return schedule < m.schedule;
+        return liftCode < m.liftCode;
     }
-    return appointment < m.appointment;
+    return start < m.start;
 }
 
 ostream &Maintenance::operator<<(ostream &out) {
@@ -86,18 +142,16 @@ bool Maintenance::operator==(const Maintenance &m) const {
 
 
 
-MaintenanceRecord::MaintenanceRecord() {}
+MaintenanceRecord::MaintenanceRecord() : maintenance(NULL) {}
 
 MaintenanceRecord::MaintenanceRecord(Maintenance *maintenance) : maintenance(maintenance) {}
 
 MaintenanceRecord::MaintenanceRecord(unsigned int code, Date appointment, Time schedule, unsigned int spnif) {
-    Maintenance m(code, appointment, schedule, spnif);
-    maintenance = &m;
+    maintenance = new Maintenance(code, appointment, schedule, spnif);
 }
 
 MaintenanceRecord::MaintenanceRecord(unsigned int code, Date appointment, Time schedule, unsigned int spnif, bool finished) {
-    Maintenance m(code, appointment, schedule, spnif, finished);
-    maintenance = &m;
+    maintenance = new Maintenance(code, appointment, schedule, spnif, finished);
 }
 
 Maintenance *MaintenanceRecord::getMaintenance() const {
@@ -105,19 +159,61 @@ Maintenance *MaintenanceRecord::getMaintenance() const {
 }
 
 bool MaintenanceRecord::operator<(const MaintenanceRecord &m) const {
-    if (maintenance->getMaintenanceDate() == m.maintenance->getMaintenanceDate()) {
-        if (maintenance->getMaintenanceSchedule() == m.maintenance->getMaintenanceSchedule()) {
-            if (maintenance->getLiftCode() == m.maintenance->getLiftCode()) {
-                return maintenance->getSpNIF() < m.maintenance->getSpNIF();
-            }
-            return maintenance->getLiftCode() < m.maintenance->getLiftCode();
-        }
-        return maintenance->getMaintenanceSchedule() < m.maintenance->getMaintenanceSchedule();
-    }
-    return maintenance->getMaintenanceDate() < m.maintenance->getMaintenanceDate();
+    return *maintenance < *m.maintenance;
 }
 
 bool MaintenanceRecord::operator==(const MaintenanceRecord &m) const {
     return maintenance == m.maintenance;
 }
 
+
+
+bool MaintenanceStartOrder::operator()(const Maintenance *a, const Maintenance *b) const {
+    if (a->getStart() != b->getStart())
+        return a->getStart() < b->getStart();
+    if (a->getLiftCode() != b->getLiftCode())
+        return a->getLiftCode() < b->getLiftCode();
+    return less<const Maintenance *>()(a, b);
+}
+
+bool MaintenanceStartOrder::operator()(const Maintenance *a, Timestamp b) const {
+    return a->getStart() < b;
+}
+
+bool MaintenanceStartOrder::operator()(Timestamp a, const Maintenance *b) const {
+    return a < b->getStart();
+}
+
+
+
+bool Agenda::empty() const {
+    return appointments.empty();
+}
+
+unsigned int Agenda::size() const {
+    return appointments.size();
+}
+
+Maintenance *Agenda::next() const {
+    return *appointments.begin();
+}
+
+bool Agenda::insert(Maintenance *m) {
+    return appointments.insert(m).second;
+}
+
+bool Agenda::cancel(Maintenance *m) {
+    return appointments.erase(m) != 0;
+}
+
+Agenda::const_iterator Agenda::from(Timestamp start) const {
+    return appointments.lower_bound(start);
+}
+
+Agenda::const_iterator Agenda::begin() const {
+    return appointments.begin();
+}
+
+Agenda::const_iterator Agenda::end() const {
+    return appointments.end();
+}
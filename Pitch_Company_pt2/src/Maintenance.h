@@ -1,10 +1,13 @@
 #ifndef MAINTENANCE_H
 #define MAINTENANCE_H
 
-#include "Utils.h"
+#include "FileWriter.h"
+#include "changes.h"
+#include <set>
 
 #define MAINTDURATION_STR "1:30:0"
 #define MAINTDURATION 1.5
+#define MAINTDURATION_SECONDS 5400 /** MAINTDURATION in seconds */
 
 class Maintenance {
 private:
@@ -12,9 +15,16 @@ private:
     unsigned int spNIF;
     Date appointment;
     Time schedule;
+    Timestamp start; /** appointment and schedule as one sort key */
     static Time duration;
     bool finished;
+    unsigned int id = 0; /** number of the maintenance in the snapshot, 0 until it is first saved */
+    bool dirty = false; /** changed since it was last saved, and so in changed */
+    ChangeList<Maintenance>::Entry changedEntry; /** position in changed, while dirty */
+    static ChangeList<Maintenance> changed; /** maintenances changed since the last save */
 public:
+    static unsigned int lastId; /** highest id given to a maintenance */
+
     /**
      * Constructor for class Maintenance
      */
@@ -36,21 +46,25 @@ public:
      * @param finished true if it was already done and false if not
      */
     Maintenance(unsigned int code, Date appointment, Time schedule, unsigned int spnif, bool finished);
+
+    Maintenance(const Maintenance &) = delete;
+
+    ~Maintenance();
     /**
      * Sends to the output file stream given as parameter information about the maintenance respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToMaintsFile(ostream &op) const;
+    void printToMaintsFile(FileWriter &op) const;
     /**
      * Sends to the output file stream, with information about the lifts, given as parameter information about that lift maintenance respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToLiftsFile(ostream &op) const;
+    void printToLiftsFile(FileWriter &op) const;
     /**
      * Sends to the output file stream, with information about the employees, given as parameter information about that employee maintenance respecting a certain structure
      * @param op output file stream to which the information will be sent
      */
-    void printToEmployeesFile(ostream &op) const;
+    void printToEmployeesFile(FileWriter &op) const;
     /**
      * @return lift code
      */
@@ -59,6 +73,11 @@ public:
      * @return NIF of the employee
      */
     unsigned int getSpNIF() const;
+    /**
+     * Sets the service provider allocated to the maintenance
+     * @param nif NIF of the service provider
+     */
+    void setSpNIF(unsigned int nif);
     /**
      * @return maintenance's schedule date
      */
@@ -73,6 +92,10 @@ public:
      * @return maintenance duration
      */
     Time getMaintenanceDuration() const;
+    /**
+     * @return moment the maintenance starts, comparable with a single integer operation
+     */
+    Timestamp getStart() const;
     /**
      *
      * @return if the maintenance is finished or not
@@ -84,6 +107,43 @@ public:
      */
     void setFinished(bool value);
 
+    /**
+     * @return number of the maintenance in the snapshot, 0 if it was never saved
+     */
+    unsigned int getId() const;
+
+    /**
+     * Gives the maintenance the next free id, if it has none yet
+     */
+    void assignId();
+
+    /**
+     * Gives the maintenance back the id it had when it was saved, making sure maintenances saved afterwards get new ids
+     * @param savedId id of the maintenance when it was saved
+     */
+    void restoreId(unsigned int savedId);
+
+    /**
+     * @return true if the maintenance changed since it was last saved
+     */
+    bool isDirty() const;
+
+    /**
+     * Marks the maintenance as changed since the last save, adding it to the ones the next save visits
+     */
+    void markChanged();
+
+    /**
+     * Marks the maintenance as saved, until it is set as finished or given to another service provider
+     */
+    void markSaved();
+
+    /**
+     * Takes out every maintenance changed since the last save, marking them as saved
+     * @param taken gets them
+     */
+    static void takeChanged(vector<Maintenance *> &taken);
+
     ostream &operator<<(ostream &out);
 
     bool operator<(const Maintenance &m) const;
@@ -130,5 +190,59 @@ public:
     bool operator==(const MaintenanceRecord &m) const;
 };
 
+/**
+ * Orders maintenances by the moment they start, then by lift code and then by address, so two different maintenances
+ * never tie. Also compares maintenances with a moment, so an Agenda can be searched by time
+ */
+struct MaintenanceStartOrder {
+    typedef void is_transparent;
+
+    bool operator()(const Maintenance *a, const Maintenance *b) const;
+
+    bool operator()(const Maintenance *a, Timestamp b) const;
+
+    bool operator()(Timestamp a, const Maintenance *b) const;
+};
+
+/**
+ * @class Agenda
+ * Appointments of a service provider, kept in the order they take place so they can be walked without being copied
+ */
+class Agenda {
+    set<Maintenance *, MaintenanceStartOrder> appointments;
+public:
+    typedef set<Maintenance *, MaintenanceStartOrder>::const_iterator const_iterator;
+
+    bool empty() const;
+
+    unsigned int size() const;
+
+    /**
+     * @return the earliest appointment, in O(1); the agenda must not be empty
+     */
+    Maintenance *next() const;
+
+    /**
+     * Adds an appointment, in O(log n)
+     * @return false if it was already in the agenda
+     */
+    bool insert(Maintenance *m);
+
+    /**
+     * Removes an appointment, in O(log n)
+     * @return false if it was not in the agenda
+     */
+    bool cancel(Maintenance *m);
+
+    /**
+     * @return the first appointment starting at the given moment or later, in O(log n)
+     */
+    const_iterator from(Timestamp start) const;
+
+    const_iterator begin() const;
+
+    const_iterator end() const;
+};
+
 
 #endif
\ No newline at end of file
@@ -1,15 +1,57 @@
 #include "Pitch.h"
 #include <iostream>
 #include <algorithm>
+#include <deque>
+#include <future>
+#include <thread>
+#include <cstring>
+#include <climits>
 
 #define maxEntrepeneurNif 600000000
 #define minEntrepeneurNif 500000000
 #define maxParticularNif  300000000
 #define minParticularNif  200000000
 
+#define LIFTSSEPARATOR "####################"
+#define LIFTSSEPARATORLENGTH 20
+#define LIFTSCHUNKBYTES (4 * 1024 * 1024) /** smallest part of the lifts file given to a thread of its own */
+
 using namespace std;
 
-Pitch::Pitch(string clientsFile, string employeesFile, string liftsFile) : maintenances(MaintenanceRecord()) {
+/**
+ * Reads a date from a line of the files without allocating, reporting errors the same way Date(string) does
+ */
+static Date readDate(const char *&first, const char *last) {
+    Date d;
+    switch (parseDate(first, last, d)) {
+        case PARSE_OK:
+            return d;
+        case PARSE_BAD_VALUE:
+            throw InvalidDate(d.day, d.month, d.year);
+        default:
+            cout << "Not a valid Date format.\n";
+            throw InvalidDate(0, 0, 0);
+    }
+}
+
+/**
+ * Reads a time from a line of the files without allocating, reporting errors the same way Time(string) does
+ */
+static Time readTime(const char *&first, const char *last) {
+    Time t;
+    switch (parseTime(first, last, t)) {
+        case PARSE_OK:
+            return t;
+        case PARSE_BAD_VALUE:
+            throw InvalidTime(t.hours, t.minutes, t.seconds);
+        default:
+            cout << "Not a valid Time format.\n";
+            throw InvalidTime(0, 0, 0);
+    }
+}
+
+Pitch::Pitch(string clientsFile, string employeesFile, string liftsFile, string snapshotFile)
+        : maintenances(MaintenanceRecord()), pendingMaintenances(MaintenanceRecord()) {
     if (clientsFile.substr(clientsFile.length() - 4, 4) != ".txt") {
         clientsFile += ".txt";
     }
@@ -24,40 +66,133 @@ Pitch::Pitch(string clientsFile, string employeesFile, string liftsFile) : maint
         liftsFile += ".txt";
     }
     this->liftsFile = liftsFile;
-
-    loadLifts();
-    loadClients();
-    loadEmployees();
+    this->snapshotFile = snapshotFile;
+    this->journalFile = snapshotFile + ".journal";
+    lastSnapshot = chrono::steady_clock::now();
+    snapshotThread = thread(&Pitch::writeSnapshots, this);
+
+    vector<JournalEntry> entries;
+    if (!journal.open(journalFile, entries))
+        cerr << "Journal opening failed.\n";
+    if (loadSnapshot()) {
+        for (vector<JournalEntry>::iterator it = entries.begin(); it != entries.end(); it++)
+            if (it->getSequence() > snapshotSequence) //older entries were already in the snapshot
+                applyJournalEntry(*it);
+    } else { //the text files are the import path when there is no up to date snapshot
+        loadTextFiles();
+        if (!entries.empty() && !textFilesNewerThan(fileModificationTime(journalFile))) {
+            //the journal has changes made after the text files on top of a snapshot that can not be read, which can
+            //not be replayed on the text files and which a new snapshot would drop: both are left as they are
+            cerr << "The snapshot could not be read, so the " << entries.size() << " changes in " << journalFile
+                 << " were not applied. Changes made now will not be saved until the snapshot is restored.\n";
+            return;
+        }
+        if (!checkpoint()) //the imported information becomes the base of the journal
+            cerr << "Snapshot saving failed.\n";
+    }
+    journaling = true;
 }
 
-void Pitch::loadLifts() {
-    ifstream inStream;
-    inStream.open(liftsFile);
-    if (inStream.fail()) {
-        cerr << "Input file opening failed.\n";
-        exit(1);
+Pitch::~Pitch() {
+    if (!waitForSnapshot())
+        cerr << "Snapshot saving failed.\n";
+    {
+        lock_guard<mutex> lock(snapshotMutex);
+        stopSnapshots = true;
     }
+    snapshotChanged.notify_all();
+    snapshotThread.join();
+    for (vector<SnapshotReader *>::iterator it = liftHistories.begin(); it != liftHistories.end(); it++)
+        delete *it;
+}
 
-    unsigned int nif, floors, secs;
-    int cFloor, hFloor, lFloor;
-    unsigned int capac;
-    string building, addr, install, info, trash, empty;
+/**
+ * Reads the line starting at first, moving first to the start of the next one
+ * @param line set to the start of the line
+ * @param lineEnd set to the end of the line, without the line break
+ * @return false if there were no more lines, in which case line and lineEnd are set to last
+ */
+static bool readLine(const char *&first, const char *last, const char *&line, const char *&lineEnd) {
+    line = lineEnd = first;
+    if (first == last)
+        return false;
+    const char *lineBreak = (const char *) memchr(first, '\n', last - first);
+    lineEnd = lineBreak == NULL ? last : lineBreak;
+    first = lineBreak == NULL ? last : lineBreak + 1;
+    if (lineEnd != line && lineEnd[-1] == '\r')
+        lineEnd--;
+    return true;
+}
 
-    while (!inStream.eof()) {
-        inStream >> nif;
-        inStream.ignore(1000000, '\n');
-        getline(inStream, building);
-        getline(inStream, addr);
-        getline(inStream, install);
-        Date d(install);
+static bool isLiftsSeparator(const char *line, const char *lineEnd) {
+    return lineEnd - line == LIFTSSEPARATORLENGTH && memcmp(line, LIFTSSEPARATOR, LIFTSSEPARATORLENGTH) == 0;
+}
 
-        inStream >> capac >> floors >> secs;
-        inStream.ignore(1000000, '\n');
+/**
+ * @return start of the first lift record from p on; a record ends with its third separator line followed by an empty
+ * line, which is found nowhere else in the file
+ */
+static const char *nextLiftRecord(const char *begin, const char *p, const char *end) {
+    if (p == begin)
+        return begin;
+    if (p[-1] != '\n') { //the search starts at a whole line
+        const char *lineBreak = (const char *) memchr(p, '\n', end - p);
+        p = lineBreak == NULL ? end : lineBreak + 1;
+    }
+    const char *line, *lineEnd;
+    bool afterSeparator = false;
+    while (readLine(p, end, line, lineEnd)) {
+        if (afterSeparator && line == lineEnd)
+            return p;
+        afterSeparator = isLiftsSeparator(line, lineEnd);
+    }
+    return end;
+}
 
-        Lift *newLift = new Lift(building, addr, capac, nif, floors, d);
+/**
+ * @return number of lift records in [first, last), each one having three separator lines
+ */
+static unsigned int countLiftRecords(const char *first, const char *last) {
+    const char *line, *lineEnd;
+    unsigned int separators = 0;
+    while (readLine(first, last, line, lineEnd))
+        if (isLiftsSeparator(line, lineEnd))
+            separators++;
+    return separators / 3;
+}
 
-        inStream >> cFloor >> hFloor >> lFloor;
-        inStream.ignore(1000000, '\n');
+/**
+ * Reads the lift records in [first, last) into parsed, giving them consecutive codes from code on
+ */
+static void parseLiftRecords(const char *first, const char *last, unsigned int code, ParsedLifts &parsed) {
+    const char *line, *lineEnd;
+    while (true) {
+        do { //records are separated by an empty line
+            if (!readLine(first, last, line, lineEnd))
+                return;
+        } while (line == lineEnd);
+
+        unsigned int nif = 0, capac = 0, floors = 0, secs = 0;
+        int cFloor = 0, hFloor = 0, lFloor = 0;
+        parseUnsigned(line, lineEnd, nif);
+        readLine(first, last, line, lineEnd);
+        string building(line, lineEnd);
+        readLine(first, last, line, lineEnd);
+        string addr(line, lineEnd);
+        readLine(first, last, line, lineEnd);
+        Date d = readDate(line, lineEnd);
+
+        readLine(first, last, line, lineEnd);
+        parseUnsigned(line, lineEnd, capac);
+        parseUnsigned(line, lineEnd, floors);
+        parseUnsigned(line, lineEnd, secs);
+
+        Lift *newLift = new Lift(code++, building, addr, capac, nif, floors, d);
+
+        readLine(first, last, line, lineEnd);
+        parseInt(line, lineEnd, cFloor);
+        parseInt(line, lineEnd, hFloor);
+        parseInt(line, lineEnd, lFloor);
 
         newLift->setPrice(); //by reading the capacity and the number of floors we can calculate the price
         newLift->setCurrentFloor(cFloor);
@@ -65,55 +200,92 @@ void Pitch::loadLifts() {
         newLift->setLowerFloor(lFloor);
         newLift->setRegularTime(secs);
 
-        getline(inStream, trash); //'####################'
-
-        while (getline(inStream, info)) { //movesHistory
-            if (info == trash) break; //lift has nothing on movesHistory vector yet or there is no more moves to add
+        readLine(first, last, line, lineEnd); //'####################'
 
-            string date, tInit;
-            int from, to;
+        //movesHistory, until the separator line, which comes right away if the lift has no moves
+        while (readLine(first, last, line, lineEnd) && !isLiftsSeparator(line, lineEnd)) {
+            int from = 0, to = 0;
 
-            stringstream moves(info);
-            moves >> date >> from >> to;
-            getline(inStream, tInit);
-            Date d(date);
-            Time tI(tInit);
+            Date d = readDate(line, lineEnd);
+            parseInt(line, lineEnd, from);
+            parseInt(line, lineEnd, to);
+            readLine(first, last, line, lineEnd);
+            Time tI = readTime(line, lineEnd);
             newLift->readMove(from, to, d, tI);
         }
 
-        while (getline(inStream, info)) { //maintHistory
-            if (info == trash)
-                break; //lift has nothing on maintHistory vector yet or there is no more maintenances to add
+        //maintHistory, until the last separator line of the lift
+        while (readLine(first, last, line, lineEnd) && !isLiftsSeparator(line, lineEnd)) {
+            unsigned int nif = 0;
 
-            string date, time;
-            unsigned int nif;
-
-            stringstream maints(info);
-            maints >> date >> time >> nif;
-            Date d(date);
-            Time t(time);
+            Date d = readDate(line, lineEnd);
+            Time t = readTime(line, lineEnd);
+            parseUnsigned(line, lineEnd, nif);
             Maintenance *maintenance = new Maintenance(newLift->getCode(), d, t, nif, true);
             newLift->addMaintenanceToMaintHistory(maintenance);
-            MaintenanceRecord m(maintenance);
-            maintenances.insert(m);
+            parsed.maintenances.push_back(maintenance);
         }
-        if (nif == 555555555) {
-            ownedLifts.push_back(newLift);
-        }
-        lifts.push_back(newLift);
+        parsed.lifts.push_back(newLift);
+    }
+}
 
-        getline(inStream, empty);
+/**
+ * Reads the lifts file into parsed, touching nothing but the lifts it creates, so it can run while the other files
+ * are read. The file is mapped in memory and split at record boundaries into parts read by different threads; lift
+ * codes still follow the order of the file
+ */
+static void parseLiftsFile(const string &liftsFile, ParsedLifts &parsed) {
+    MappedFile file;
+    if (!file.open(liftsFile)) {
+        if (fileModificationTime(liftsFile) < 0)
+            throw InputFileOpeningFailed(liftsFile);
+        return; //the file is empty
     }
-    inStream.close();
+    const char *begin = file.data(), *end = begin + file.size();
+
+    unsigned int numChunks = max(thread::hardware_concurrency(), 1u);
+    numChunks = (unsigned int) min((uint64_t) numChunks, (uint64_t) file.size() / LIFTSCHUNKBYTES + 1);
+    vector<const char *> bounds(numChunks + 1, end);
+    for (unsigned int i = 1; i < numChunks; i++)
+        bounds[i] = nextLiftRecord(begin, begin + (uint64_t) file.size() * i / numChunks, end);
+    bounds[0] = begin;
+
+    //each part needs to know how many lifts come before it to number its own
+    vector<future<unsigned int> > counting;
+    for (unsigned int i = 0; i + 1 < numChunks; i++)
+        counting.push_back(async(launch::async, countLiftRecords, bounds[i], bounds[i + 1]));
+    vector<unsigned int> firstCode(numChunks, Lift::nLifts + FIRSTLIFTCODE);
+    for (unsigned int i = 0; i + 1 < numChunks; i++)
+        firstCode[i + 1] = firstCode[i] + counting[i].get();
+
+    vector<ParsedLifts> chunks(numChunks);
+    {
+        vector<future<void> > parsing;
+        for (unsigned int i = 0; i < numChunks; i++)
+            parsing.push_back(async(launch::async, parseLiftRecords, bounds[i], bounds[i + 1], firstCode[i],
+                                    ref(chunks[i])));
+        for (unsigned int i = 0; i < numChunks; i++)
+            parsing[i].wait();
+        for (unsigned int i = 0; i < numChunks; i++)
+            parsing[i].get(); //rethrows what went wrong while reading each part
+    }
+
+    for (unsigned int i = 0; i < numChunks; i++) {
+        parsed.lifts.insert(parsed.lifts.end(), chunks[i].lifts.begin(), chunks[i].lifts.end());
+        parsed.maintenances.insert(parsed.maintenances.end(), chunks[i].maintenances.begin(),
+                                   chunks[i].maintenances.end());
+    }
+    Lift::nLifts += parsed.lifts.size();
 }
 
-void Pitch::loadClients() {
+/**
+ * Reads the clients file into parsed, keeping the codes of their lifts to be resolved once the lifts are loaded
+ */
+static void parseClientsFile(const string &clientsFile, ParsedClients &parsed) {
     ifstream inStream;
     inStream.open(clientsFile);
-    if (inStream.fail()) {
-        cerr << "Input file opening failed.\n";
-        exit(1);
-    }
+    if (inStream.fail())
+        throw InputFileOpeningFailed(clientsFile);
 
     string name, first, info, empty;
     unsigned int cNif, eNif;
@@ -134,26 +306,29 @@ void Pitch::loadClients() {
             newClient = new ParticularClient(name, cNif, first);
         }
 
+        parsed.liftCodes.push_back(vector<unsigned int>());
         while (getline(inStream, info)) {
             if (info == "####################")
                 break; //client has nothing on lifts vector yet there is no more lifts to add
 
-            newClient->purchaseNewLift(searchLift((unsigned int) stoi(info)));
+            parsed.liftCodes.back().push_back((unsigned int) stoi(info));
         }
-        clients.insert(newClient);
+        parsed.clients.push_back(newClient);
         getline(inStream, empty);
     }
 
     inStream.close();
 }
 
-void Pitch::loadEmployees() {
+/**
+ * Reads the employees file into parsed, keeping the NIFs of the clients of contracted employees to be resolved once
+ * the clients are loaded
+ */
+static void parseEmployeesFile(const string &employeesFile, ParsedEmployees &parsed) {
     ifstream inStream;
     inStream.open(employeesFile);
-    if (inStream.fail()) {
-        cerr << "Input file opening failed.\n";
-        exit(1);
-    }
+    if (inStream.fail())
+        throw InputFileOpeningFailed(employeesFile);
 
     string name, empty;
     unsigned int nif, age, nRev, eva;
@@ -178,10 +353,7 @@ void Pitch::loadEmployees() {
             inStream >> salary >> hours >> numMaints;
             inStream.ignore(1000000, '\n');
 
-            Employee *newEmployee = new ServiceProvider(name, nif, age, salary);
-            ServiceProvider *sp;
-            sp = dynamic_cast<ServiceProvider *>(newEmployee);
-            ServiceProviderType spt(sp);
+            ServiceProvider *sp = new ServiceProvider(name, nif, age, salary);
             sp->setOldReviews(eva, nRev);
             sp->setHoursWorked(hours);
             sp->setNumMaintenances(numMaints);
@@ -191,20 +363,19 @@ void Pitch::loadEmployees() {
             while (getline(inStream, info)) { //service provider schedule
                 if (info == trash) break; //service provider has nothing on his schedule
 
-                string date, time;
-                unsigned int code;
+                unsigned int code = 0;
 
-                stringstream maints(info);
-                maints >> code >> date >> time;
-                Date d(date);
-                Time t(time);
+                const char *p = info.data(), *end = p + info.size();
+                parseUnsigned(p, end, code);
+                Date d = readDate(p, end);
+                Time t = readTime(p, end);
                 Maintenance *m = new Maintenance(code, d, t, sp->getNif(), false);
-                maintenances.insert(MaintenanceRecord(m));
+                parsed.maintenances.push_back(m);
                 sp->scheduleMaintenance(m);
             }
 
-            employees.push_back(sp);
-            serviceProviders.push(spt);
+            parsed.employees.push_back(sp);
+            parsed.clientNifs.push_back(vector<unsigned int>());
 
             inStream >> identifier;
             inStream.ignore(1000000, '\n');
@@ -215,24 +386,17 @@ void Pitch::loadEmployees() {
             inStream >> salary;
             inStream.ignore(1000000, '\n');
 
-            Employee *newEmployee = new ContractedEmployee(name, nif, age, salary);
-            ContractedEmployee *ce;
-            ce = dynamic_cast<ContractedEmployee *>(newEmployee);
-            ContractedEmployeeType cet(ce);
+            ContractedEmployee *ce = new ContractedEmployee(name, nif, age, salary);
             ce->setOldReviews(eva, nRev);
 
             string cnifs;
             getline(inStream, cnifs);
-            istringstream instr(cnifs);
-            instr >> cNif;
-            if (cNif != 0) { //has clients associated
-                ce->associateToClient(searchClient(cNif));
-                while (instr >> cNif) {
-                    ce->associateToClient(searchClient(cNif));
-                }
+            parsed.clientNifs.push_back(vector<unsigned int>());
+            const char *p = cnifs.data(), *end = p + cnifs.size();
+            while (parseUnsigned(p, end, cNif) && cNif != 0) { //a single 0 means no clients associated
+                parsed.clientNifs.back().push_back(cNif);
             }
-            employees.push_back(ce);
-            contractedEmployees.push(cet);
+            parsed.employees.push_back(ce);
 
             inStream >> identifier;
             inStream.ignore(1000000, '\n');
@@ -242,63 +406,1094 @@ void Pitch::loadEmployees() {
     inStream.close();
 }
 
+/**
+ * Waits for task to finish reading its file, reporting if the file could not be opened
+ * @return false if it could not
+ */
+static bool readFinished(future<void> &task) {
+    try {
+        task.get();
+    } catch (InputFileOpeningFailed &e) {
+        cerr << e.what() << '\n';
+        return false;
+    }
+    return true;
+}
+
+void Pitch::loadTextFiles() {
+    ParsedLifts parsedLifts;
+    ParsedClients parsedClients;
+    ParsedEmployees parsedEmployees;
+    {
+        //the three files are read at the same time, since they are only linked to each other afterwards
+        future<void> lifts = async(launch::async, parseLiftsFile, cref(liftsFile), ref(parsedLifts));
+        future<void> clients = async(launch::async, parseClientsFile, cref(clientsFile), ref(parsedClients));
+        future<void> employees = async(launch::async, parseEmployeesFile, cref(employeesFile), ref(parsedEmployees));
+        //what went wrong while reading each file is reported here rather than on the thread that read it
+        bool read = readFinished(lifts);
+        read = readFinished(clients) && read;
+        read = readFinished(employees) && read;
+        if (!read)
+            exit(1);
+    }
+    addLoadedLifts(parsedLifts);
+    addLoadedClients(parsedClients);
+    addLoadedEmployees(parsedEmployees);
+}
+
+void Pitch::addLoadedLifts(ParsedLifts &parsed) {
+    for (vector<Lift *>::iterator it = parsed.lifts.begin(); it != parsed.lifts.end(); it++) {
+        if ((*it)->getClientNif() == 555555555) {
+            ownedLifts.push_back(*it);
+        }
+        lifts.push_back(*it);
+        indexLift(*it);
+        (*it)->markChanged();
+    }
+    for (vector<Maintenance *>::iterator it = parsed.maintenances.begin(); it != parsed.maintenances.end(); it++) {
+        maintenances.insert(MaintenanceRecord(*it));
+        (*it)->markChanged();
+    }
+}
+
+void Pitch::addLoadedClients(ParsedClients &parsed) {
+    for (unsigned int i = 0; i < parsed.clients.size(); i++) {
+        Client *newClient = parsed.clients[i];
+        for (vector<unsigned int>::iterator code = parsed.liftCodes[i].begin(); code != parsed.liftCodes[i].end(); code++)
+            newClient->purchaseNewLift(searchLift(*code));
+        clients.insert(newClient);
+        newClient->markChanged();
+    }
+}
+
+void Pitch::addLoadedEmployees(ParsedEmployees &parsed) {
+    for (vector<Maintenance *>::iterator it = parsed.maintenances.begin(); it != parsed.maintenances.end(); it++)
+        addMaintenance(*it);
+    for (unsigned int i = 0; i < parsed.employees.size(); i++) {
+        ServiceProvider *sp = dynamic_cast<ServiceProvider *>(parsed.employees[i]);
+        if (sp != NULL) {
+            employees.push_back(sp);
+            serviceProvidersByNif[sp->getNif()] = sp;
+            serviceProviders.push(ServiceProviderType(sp));
+            sp->attachCalendar(&calendar);
+        } else {
+            ContractedEmployee *ce = dynamic_cast<ContractedEmployee *>(parsed.employees[i]);
+            for (vector<unsigned int>::iterator nif = parsed.clientNifs[i].begin(); nif != parsed.clientNifs[i].end(); nif++)
+                ce->associateToClient(searchClient(*nif));
+            employees.push_back(ce);
+            contractedEmployeesByNif[ce->getNif()] = ce;
+            contractedEmployees.push(ContractedEmployeeType(ce));
+            contractedEmployeesByLoad.push(ce);
+        }
+        parsed.employees[i]->markChanged();
+    }
+}
+
+void Pitch::loadLifts() {
+    ParsedLifts parsed;
+    parseLiftsFile(liftsFile, parsed);
+    addLoadedLifts(parsed);
+}
+
+void Pitch::loadClients() {
+    ParsedClients parsed;
+    parseClientsFile(clientsFile, parsed);
+    addLoadedClients(parsed);
+}
+
+void Pitch::loadEmployees() {
+    ParsedEmployees parsed;
+    parseEmployeesFile(employeesFile, parsed);
+    addLoadedEmployees(parsed);
+}
+
 void Pitch::saveLifts() {
-    ofstream opStream;
-    opStream.open(liftsFile);
-    if (opStream.fail()) {
+    if (!textWriter.open(liftsFile)) {
         cerr << "Input file opening failed.\n";
         exit(1);
     }
     for (vector<Lift *>::iterator it = lifts.begin(); it != lifts.end(); it++) {
-        (*it)->printToFile(opStream);
+        (*it)->printToFile(textWriter);
         if (it != lifts.end() - 1)
-            opStream << endl;
+            textWriter << '\n';
     }
-    opStream.close();
+    textWriter.close();
 }
 
 void Pitch::saveClients() {
-    ofstream opStream;
-    opStream.open(clientsFile);
-    if (opStream.fail()) {
+    if (!textWriter.open(clientsFile)) {
         cerr << "Input file opening failed.\n";
         exit(1);
     }
 
     for (HashTableClient::iterator it = clients.begin(); it != clients.end(); it++) {
-        (*it)->printToFile(opStream);
+        (*it)->printToFile(textWriter);
     }
-    opStream.close();
+    textWriter.close();
 }
 
 void Pitch::saveEmployees() {
-    ofstream opStream;
-    opStream.open(employeesFile);
-    if (opStream.fail()) {
+    if (!textWriter.open(employeesFile)) {
         cerr << "Input file opening failed.\n";
         exit(1);
     }
     for (vector<Employee *>::iterator it = employees.begin(); it != employees.end(); it++) {
-        (*it)->printToFile(opStream);
+        (*it)->printToFile(textWriter);
         if (it != employees.end() - 1)
-            opStream << endl;
+            textWriter << '\n';
     }
-    opStream.close();
+    textWriter.close();
 }
 
 void Pitch::saveData() {
+    if (!journal.commit())
+        cerr << "Journal saving failed.\n";
+    if (journaling && snapshotDue() && !snapshotInProgress()) //not over a journal that could not be replayed
+        startSnapshot();
+}
+
+void Pitch::exportData() {
     saveClients();
     saveEmployees();
     saveLifts();
+    if (journaling && !checkpoint()) //otherwise the text files, being newer, would be loaded instead of the snapshot
+        cerr << "Snapshot saving failed.\n";
 }
 
-Client *Pitch::searchClient(unsigned int searchedNIF) {
-    for (HashTableClient::iterator it = clients.begin(); it != clients.end(); it++) {
-        if ((*it)->getNif() == searchedNIF) {
-            return *it;
+bool Pitch::checkpoint() {
+    startSnapshot();
+    return waitForSnapshot();
+}
+
+bool Pitch::snapshotDue() const {
+    if (journal.size() >= JOURNALCHECKPOINTBYTES)
+        return true;
+    return snapshotInterval > 0 && journal.getLastSequence() > snapshotSequence &&
+           chrono::steady_clock::now() - lastSnapshot >= chrono::seconds(snapshotInterval);
+}
+
+bool Pitch::snapshotInProgress() {
+    lock_guard<mutex> lock(snapshotMutex);
+    return snapshotJob != NULL && !snapshotJob->done;
+}
+
+void Pitch::setSnapshotInterval(unsigned int seconds) {
+    snapshotInterval = seconds;
+}
+
+void Pitch::record(JournalEntry &entry) {
+    if (!journaling)
+        return;
+    if (!journal.append(entry))
+        cerr << "Journal saving failed.\n";
+    if (snapshotDue() && !snapshotInProgress()) //otherwise it is tried again with the next mutation
+        startSnapshot();
+}
+
+void Pitch::applyJournalEntry(JournalEntry &entry) {
+    switch (entry.getType()) {
+        case JOURNAL_MOVE: { //code, from, to, date, time
+            Lift *lift = findLift(entry.getUnsigned());
+            int from = entry.getInt(), to = entry.getInt();
+            Date date = entry.getDate();
+            Time time = entry.getTime();
+            if (lift != NULL)
+                lift->readMove(from, to, date, time);
+            break;
+        }
+        case JOURNAL_LIFT_ADDED: { //code, client, name, address, install, capacity, floors, regular time, current, higher and lower floors
+            unsigned int code = entry.getUnsigned(), clientNif = entry.getUnsigned();
+            string name = entry.getString(), address = entry.getString();
+            Date install = entry.getDate();
+            unsigned int capacity = entry.getUnsigned(), nFloors = entry.getUnsigned();
+            Lift *newLift = new Lift(name, address, capacity, clientNif, nFloors, install);
+            newLift->restoreCode(code);
+            newLift->setPrice();
+            newLift->setRegularTime(entry.getInt());
+            newLift->setCurrentFloor(entry.getInt());
+            newLift->setHigherFloor(entry.getInt());
+            newLift->setLowerFloor(entry.getInt());
+            addLift(newLift);
+            Client *owner = findClient(clientNif);
+            if (owner != NULL)
+                owner->purchaseNewLift(newLift);
+            break;
         }
+        case JOURNAL_LIFT_REMOVED: //code
+            removeLift(entry.getUnsigned());
+            break;
+        case JOURNAL_CLIENT_ADDED: { //nif, entrepreneur, name, date of the first lift, contracted employee
+            unsigned int nif = entry.getUnsigned();
+            bool entrepreneur = entry.getUnsigned() != 0;
+            string name = entry.getString();
+            Date firstLift = entry.getDate();
+            unsigned int employeeNif = entry.getUnsigned();
+            if (entrepreneur) {
+                Entrepreneur *e = new Entrepreneur(name, nif, firstLift);
+                if (employeeNif != 0)
+                    e->associateEmployee(employeeNif);
+                addClient(e);
+            } else {
+                addClient(new ParticularClient(name, nif, firstLift));
+            }
+            break;
+        }
+        case JOURNAL_CLIENT_REMOVED: //nif
+            removeClient(entry.getUnsigned());
+            break;
+        case JOURNAL_CLIENT_ASSOCIATED: { //client, contracted employee
+            Client *c = findClient(entry.getUnsigned());
+            ContractedEmployee *ce = findContractedEmployee(entry.getUnsigned());
+            if (c != NULL && ce != NULL)
+                associate(c, ce);
+            break;
+        }
+        case JOURNAL_EMPLOYEE_ADDED: { //kind, name, nif, age, salary
+            unsigned int kind = entry.getUnsigned();
+            string name = entry.getString();
+            unsigned int nif = entry.getUnsigned(), age = entry.getUnsigned();
+            double salary = entry.getDouble();
+            if (kind == 'x')
+                registerEmployee(new ContractedEmployee(name, nif, age, salary));
+            else
+                registerEmployee(new ServiceProvider(name, nif, age, salary));
+            break;
+        }
+        case JOURNAL_EMPLOYEE_REMOVED: { //nif, after the entries that moved his clients or maintenances
+            Employee *e = findEmployee(entry.getUnsigned());
+            if (e != NULL)
+                forgetEmployee(e);
+            break;
+        }
+        case JOURNAL_EMPLOYEE_REVIEWED: { //nif, evaluation
+            unsigned int nif = entry.getUnsigned(), eva = entry.getUnsigned();
+            ServiceProvider *sp = findServiceProvider(nif);
+            ContractedEmployee *ce = findContractedEmployee(nif);
+            if (sp != NULL)
+                reviewMaintenance(sp, eva);
+            else if (ce != NULL)
+                reviewContractedEmployee(ce, eva);
+            break;
+        }
+        case JOURNAL_MAINTENANCE_SCHEDULED: { //code, service provider, date, time
+            unsigned int code = entry.getUnsigned();
+            ServiceProvider *sp = findServiceProvider(entry.getUnsigned());
+            Date appoint = entry.getDate();
+            Time sched = entry.getTime();
+            if (sp != NULL)
+                assignMaintenance(code, sp, appoint, sched);
+            break;
+        }
+        case JOURNAL_MAINTENANCE_REASSIGNED: { //code, previous service provider, date, time, new service provider
+            unsigned int code = entry.getUnsigned(), previous = entry.getUnsigned();
+            Date appoint = entry.getDate();
+            Time sched = entry.getTime();
+            Maintenance probe(code, appoint, sched, previous);
+            Maintenance *m = maintenances.find(MaintenanceRecord(&probe)).getMaintenance();
+            ServiceProvider *sp = findServiceProvider(entry.getUnsigned());
+            if (m != NULL && sp != NULL)
+                moveMaintenance(m, sp);
+            break;
+        }
+        case JOURNAL_MAINTENANCE_AUTOMATIC: { //code, service provider, date, time
+            Lift *lift = findLift(entry.getUnsigned());
+            ServiceProvider *sp = findServiceProvider(entry.getUnsigned());
+            Date today = entry.getDate();
+            Time time = entry.getTime();
+            if (lift != NULL && sp != NULL)
+                executeAutomaticMaintenance(lift, sp, today, time);
+            break;
+        }
+        case JOURNAL_MAINTENANCES_UPDATED: { //date, time
+            Date date = entry.getDate();
+            updateMaintenances(entry.getTime(), date);
+            break;
+        }
+        case JOURNAL_MAINTENANCE_CANCELLED: { //code, service provider, date, time
+            unsigned int code = entry.getUnsigned(), nif = entry.getUnsigned();
+            Date appoint = entry.getDate();
+            Time sched = entry.getTime();
+            Maintenance probe(code, appoint, sched, nif);
+            Maintenance *m = maintenances.find(MaintenanceRecord(&probe)).getMaintenance();
+            if (m != NULL)
+                cancelMaintenance(m);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static SnapshotMaintenance toSnapshot(const Maintenance *m) {
+    SnapshotMaintenance rec;
+    rec.id = m->getId();
+    rec.liftCode = m->getLiftCode();
+    rec.spNif = m->getSpNIF();
+    rec.appointment = m->getMaintenanceDate().toKey();
+    rec.schedule = m->getMaintenanceSchedule().toSeconds();
+    rec.finished = m->getFinished();
+    return rec;
+}
+
+static Maintenance *fromSnapshot(const SnapshotMaintenance &rec) {
+    return new Maintenance(rec.liftCode, Date::fromKey(rec.appointment), Time::fromSeconds(rec.schedule), rec.spNif,
+                           rec.finished != 0);
+}
+
+/**
+ * @return position of a saved maintenance in the trees of maintenances
+ */
+static tuple<Timestamp, uint32_t, uint32_t> treeKey(const SnapshotMaintenance &rec) {
+    return make_tuple(toTimestamp(Date::fromKey(rec.appointment), Time::fromSeconds(rec.schedule)), rec.liftCode,
+                      rec.spNif);
+}
+
+static bool treeOrder(const SnapshotMaintenance &a, const SnapshotMaintenance &b) {
+    return treeKey(a) < treeKey(b);
+}
+
+static bool codeOrder(const SnapshotLift &a, const SnapshotLift &b) {
+    return a.code < b.code;
+}
+
+static bool segmentOrder(const SnapshotSegment &a, const SnapshotSegment &b) {
+    return a.kind != b.kind ? a.kind < b.kind : a.number < b.number;
+}
+
+/**
+ * Adds the lift, with its maintenance history, to a snapshot; its moves are added apart
+ */
+static void addToSnapshot(SnapshotWriter &snap, Lift *l) {
+    SnapshotLift rec;
+    rec.code = l->getCode();
+    rec.clientNif = l->getClientNif();
+    rec.capacity = l->getCapacity();
+    rec.nFloors = l->getNumFloors();
+    rec.regularTime = l->getRegularTime();
+    rec.currentFloor = l->getCurrentFloor();
+    rec.higherFloor = l->getHigherFloor();
+    rec.lowerFloor = l->getLowerFloor();
+    rec.install = l->getInstallDate().toKey();
+    rec.buildingName = snap.addString(l->getName());
+    rec.address = snap.addString(l->getAddress());
+
+    const vector<Maintenance *> &history = l->getMaintHistory();
+    rec.firstMaintenance = snap.refs.size();
+    rec.numMaintenances = history.size();
+    for (vector<Maintenance *>::const_iterator m = history.begin(); m != history.end(); m++)
+        snap.refs.push_back((*m)->getId());
+
+    snap.lifts.push_back(rec);
+}
+
+/**
+ * Adds the maintenance to the maintenances segment of a snapshot, giving it an id if it has none yet
+ */
+static void addToSnapshot(SnapshotWriter &snap, Maintenance *m) {
+    m->assignId();
+    snap.maintenances.push_back(toSnapshot(m));
+}
+/**
+ * Adds the client, with the codes of his lifts, to a snapshot
+ */
+static void addToSnapshot(SnapshotWriter &snap, Client *c) {
+    Entrepreneur *e = dynamic_cast<Entrepreneur *>(c);
+    SnapshotClient rec;
+    rec.nif = c->getNif();
+    rec.entrepreneur = e != NULL;
+    rec.employeeNif = e != NULL ? e->getEmployeeNif() : 0;
+    rec.firstLift = c->getDateFirstLift().toKey();
+    rec.name = snap.addString(c->getName());
+
+    vector<Lift *> owned = c->getLifts();
+    rec.firstLiftRef = snap.refs.size();
+    rec.numLifts = owned.size();
+    for (vector<Lift *>::iterator l = owned.begin(); l != owned.end(); l++)
+        snap.refs.push_back((*l)->getCode());
+
+    snap.clients.push_back(rec);
+}
+
+/**
+ * Adds the employee to a snapshot, with his schedule or with the NIFs of his clients
+ */
+static void addToSnapshot(SnapshotWriter &snap, Employee *employee) {
+    SnapshotEmployee rec;
+    rec.nif = employee->getNif();
+    rec.age = employee->getAge();
+    rec.evaluation = employee->getEvaluation();
+    rec.numReviews = employee->getNumOfReviews();
+    rec.name = snap.addString(employee->getName());
+
+    ServiceProvider *sp = dynamic_cast<ServiceProvider *>(employee);
+    if (sp != NULL) {
+        rec.kind = '+';
+        rec.salary = sp->getPerHourSalary();
+        rec.hoursWorked = sp->getHoursWorked();
+        rec.numMaintenances = sp->getNumMaintenancesDone();
+        const Agenda &schedule = sp->getSchedule();
+        rec.firstRef = snap.refs.size();
+        rec.numRefs = schedule.size();
+        for (Agenda::const_iterator it = schedule.begin(); it != schedule.end(); it++)
+            snap.refs.push_back((*it)->getId());
+    } else {
+        ContractedEmployee *ce = dynamic_cast<ContractedEmployee *>(employee);
+        rec.kind = 'x';
+        rec.salary = ce->getPerMonthSalary();
+        rec.hoursWorked = 0;
+        rec.numMaintenances = 0;
+        vector<Client *> associated = ce->getClientsAssociated();
+        rec.firstRef = snap.refs.size();
+        rec.numRefs = associated.size();
+        for (vector<Client *>::iterator c = associated.begin(); c != associated.end(); c++)
+            snap.refs.push_back((*c)->getNif());
+    }
+    snap.employees.push_back(rec);
+}
+
+/**
+ * Copies a lift saved in another snapshot, with its moves as they are there
+ */
+static void copyToSnapshot(SnapshotWriter &snap, const SnapshotReader &from, const SnapshotLift &saved) {
+    SnapshotLift rec = saved;
+    rec.buildingName = snap.addString(from.str(saved.buildingName));
+    rec.address = snap.addString(from.str(saved.address));
+    rec.firstMaintenance = snap.refs.size();
+    snap.refs.insert(snap.refs.end(), from.refs() + saved.firstMaintenance,
+                     from.refs() + saved.firstMaintenance + saved.numMaintenances);
+    snap.copyMoves(from, saved, rec);
+    snap.lifts.push_back(rec);
+}
+
+static void copyToSnapshot(SnapshotWriter &snap, const SnapshotReader &, const SnapshotMaintenance &saved) {
+    snap.maintenances.push_back(saved);
+}
+
+static void copyToSnapshot(SnapshotWriter &snap, const SnapshotReader &from, const SnapshotClient &saved) {
+    SnapshotClient rec = saved;
+    rec.name = snap.addString(from.str(saved.name));
+    rec.firstLiftRef = snap.refs.size();
+    snap.refs.insert(snap.refs.end(), from.refs() + saved.firstLiftRef,
+                     from.refs() + saved.firstLiftRef + saved.numLifts);
+    snap.clients.push_back(rec);
+}
+
+static void copyToSnapshot(SnapshotWriter &snap, const SnapshotReader &from, const SnapshotEmployee &saved) {
+    SnapshotEmployee rec = saved;
+    rec.name = snap.addString(from.str(saved.name));
+    rec.firstRef = snap.refs.size();
+    snap.refs.insert(snap.refs.end(), from.refs() + saved.firstRef, from.refs() + saved.firstRef + saved.numRefs);
+    snap.employees.push_back(rec);
+}
+
+static bool nifOrder(const SnapshotClient &a, const SnapshotClient &b) {
+    return a.nif < b.nif;
+}
+
+static bool employeeOrder(const SnapshotEmployee &a, const SnapshotEmployee &b) {
+    return a.nif < b.nif;
+}
+
+/**
+ * Adds to a segment update the records of the file saved before whose members did not change, and writes it
+ * @return false if the file saved before, or the new one, could not be opened or written
+ */
+static bool writeSegment(SegmentUpdate &update, const string &snapshotFile) {
+    SnapshotWriter &snap = update.records;
+    SnapshotReader base;
+    SnapshotSegment baseSegment = update.segment;
+    baseSegment.generation = update.baseGeneration;
+    if (update.baseGeneration != 0 && !base.open(segmentPath(snapshotFile, baseSegment)))
+        return false;
+
+    //the lifts that did not move since the save before keep their moves as they are in its file, without decoding them
+    unordered_map<uint32_t, const SnapshotLift *> savedLifts;
+    for (uint64_t i = 0; i < base.count(SNAPSHOT_LIFTS); i++)
+        savedLifts[base.lifts()[i].code] = &base.lifts()[i];
+    for (unsigned int i = 0; i < snap.lifts.size(); i++) {
+        if (!update.movesFromBase[i]) {
+            snap.addMoves(update.moves[i], snap.lifts[i]);
+            continue;
+        }
+        unordered_map<uint32_t, const SnapshotLift *>::iterator saved = savedLifts.find(snap.lifts[i].code);
+        if (saved == savedLifts.end())
+            return false;
+        snap.copyMoves(base, *saved->second, snap.lifts[i]);
     }
-    throw ClientDoesNotExist(searchedNIF);
+
+    for (uint64_t i = 0; i < base.count(SNAPSHOT_LIFTS); i++)
+        if (update.dropped.count(base.lifts()[i].code) == 0)
+            copyToSnapshot(snap, base, base.lifts()[i]);
+    for (uint64_t i = 0; i < base.count(SNAPSHOT_MAINTENANCES); i++)
+        if (update.dropped.count(base.maintenances()[i].id) == 0)
+            copyToSnapshot(snap, base, base.maintenances()[i]);
+    for (uint64_t i = 0; i < base.count(SNAPSHOT_CLIENTS); i++)
+        if (update.dropped.count(base.clients()[i].nif) == 0)
+            copyToSnapshot(snap, base, base.clients()[i]);
+    for (uint64_t i = 0; i < base.count(SNAPSHOT_EMPLOYEES); i++)
+        if (update.dropped.count(base.employees()[i].nif) == 0)
+            copyToSnapshot(snap, base, base.employees()[i]);
+    sort(snap.lifts.begin(), snap.lifts.end(), codeOrder);
+    sort(snap.maintenances.begin(), snap.maintenances.end(), treeOrder); //loading expects them in the order of the tree
+    sort(snap.clients.begin(), snap.clients.end(), nifOrder);
+    sort(snap.employees.begin(), snap.employees.end(), employeeOrder);
+
+    if (snap.lifts.empty() && snap.maintenances.empty() && snap.clients.empty() && snap.employees.empty())
+        return true; //left without members, the segment is only dropped from the main file
+    if (!snap.write(segmentPath(snapshotFile, update.segment)))
+        return false;
+    update.written = true;
+    if (update.segment.kind == SEGMENT_LIFTS) { //opened here, so the thread that changes Pitch only has to attach it
+        update.opened = new SnapshotReader();
+        if (!update.opened->open(segmentPath(snapshotFile, update.segment))) {
+            delete update.opened;
+            update.opened = NULL;
+        }
+    }
+    return true;
+}
+/**
+ * @return number of the segment where the lift with the given code, the client or employee with the given NIF, or the
+ * maintenance with the given Date::toKey() of its appointment is saved
+ */
+static unsigned int segmentOf(SnapshotSegmentKind kind, unsigned int key) {
+    switch (kind) {
+        case SEGMENT_MAINTENANCES: { //by month, so the numbers of the segments follow the order of the maintenances
+            unsigned int year = key >> 9, month = key >> 5 & 15; //see Date::toKey
+            if (year < MAINTENANCEFIRSTYEAR)
+                return 0;
+            return (year - MAINTENANCEFIRSTYEAR) * 12 + max(month, 1u) - 1;
+        }
+        case SEGMENT_LIFTS:
+            return (key - FIRSTLIFTCODE) / LIFTSPERSEGMENT;
+        case SEGMENT_CLIENTS:
+            return key % CLIENTSEGMENTS;
+        default:
+            return key % EMPLOYEESEGMENTS;
+    }
+}
+
+/**
+ * @return number of threads to spread n segment files over, at most one per core
+ */
+static unsigned int segmentThreads(size_t n) {
+    return (unsigned int) max((size_t) 1, min((size_t) max(thread::hardware_concurrency(), 1u), n));
+}
+
+/**
+ * Opens the segment files at paths into readers, from the one at first on, every step of them
+ * @return false if one of them could not be opened
+ */
+static bool openSegments(const vector<SnapshotReader *> &readers, const vector<string> &paths, unsigned int first,
+                         unsigned int step) {
+    bool opened = true;
+    for (unsigned int i = first; opened && i < readers.size(); i += step)
+        opened = readers[i]->open(paths[i]);
+    return opened;
+}
+
+/**
+ * Writes the segments of a save, from the one at first on, every step of them
+ * @return false if one of them could not be written
+ */
+static bool writeSegments(SnapshotJob &job, const string &snapshotFile, unsigned int first, unsigned int step) {
+    bool written = true;
+    for (unsigned int i = first; written && i < job.segments.size(); i += step)
+        written = writeSegment(job.segments[i], snapshotFile);
+    return written;
+}
+
+void Pitch::markRemoved(SnapshotSegmentKind kind, unsigned int segmentKey, uint32_t key) {
+    RemovedMember removed = {kind, segmentKey, key};
+    removedMembers.push_back(removed);
+}
+
+SegmentUpdate &Pitch::updateOf(SnapshotJob &job, map<pair<unsigned int, unsigned int>, SegmentUpdate *> &updates,
+                               SnapshotSegmentKind kind, unsigned int key) {
+    unsigned int number = segmentOf(kind, key);
+    SegmentUpdate *&update = updates[make_pair((unsigned int) kind, number)];
+    if (update == NULL) {
+        job.segments.emplace_back();
+        update = &job.segments.back();
+        SnapshotSegment segment = {(uint32_t) kind, number, job.manifest.generation};
+        update->segment = segment;
+        update->records.generation = job.manifest.generation;
+        const vector<uint64_t> &saved = segmentGenerations[kind];
+        update->baseGeneration = number < saved.size() ? saved[number] : 0;
+    }
+    return *update;
+}
+
+bool Pitch::holds(Maintenance *m) const {
+    return maintenances.find(MaintenanceRecord(m)).getMaintenance() == m;
+}
+
+bool Pitch::holds(Lift *l) const {
+    return findLift(l->getCode()) == l;
+}
+
+bool Pitch::holds(Client *c) const {
+    return findClient(c->getNif()) == c;
+}
+
+bool Pitch::holds(Employee *e) const {
+    return findEmployee(e->getNif()) == e;
+}
+
+template<class T>
+void Pitch::keepHeld(vector<T *> &members) const {
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < members.size(); i++)
+        if (holds(members[i]))
+            members[kept++] = members[i];
+    members.resize(kept);
+}
+
+void Pitch::startSnapshot() {
+    if (!waitForSnapshot()) //each save builds on the segments of the one before
+        cerr << "Snapshot saving failed.\n";
+
+    //only the members that changed are copied now, to the segments they are in; snapshotThread adds the others from
+    //the files saved before and writes new files, which only replace the old ones once the main file lists them. The
+    //journal entries appended until now are all in the save
+    uint64_t generation = snapshotGeneration + 1;
+    SnapshotJob *job = new SnapshotJob();
+    journal.commit();
+    job->journalBytes = journal.size();
+    job->manifest.journalSequence = journal.getLastSequence();
+    job->manifest.generation = generation;
+
+    vector<Maintenance *> changedMaintenances;
+    vector<Lift *> changedLifts;
+    vector<Client *> changedClients;
+    vector<Employee *> changedEmployees;
+    Maintenance::takeChanged(changedMaintenances);
+    Lift::takeChanged(changedLifts);
+    Client::takeChanged(changedClients);
+    Employee::takeChanged(changedEmployees);
+    keepHeld(changedMaintenances);
+    keepHeld(changedLifts);
+    keepHeld(changedClients);
+    keepHeld(changedEmployees);
+    job->removed.swap(removedMembers);
+
+    map<pair<unsigned int, unsigned int>, SegmentUpdate *> updates;
+    for (vector<RemovedMember>::iterator it = job->removed.begin(); it != job->removed.end(); it++)
+        updateOf(*job, updates, it->kind, it->segmentKey).dropped.insert(it->key);
+    //maintenances first, so every one has an id before lifts and service providers refer to it
+    for (vector<Maintenance *>::iterator it = changedMaintenances.begin(); it != changedMaintenances.end(); it++) {
+        SegmentUpdate &update = updateOf(*job, updates, SEGMENT_MAINTENANCES, (*it)->getMaintenanceDate().toKey());
+        addToSnapshot(update.records, *it);
+        update.dropped.insert((*it)->getId());
+    }
+    for (vector<Lift *>::iterator it = changedLifts.begin(); it != changedLifts.end(); it++) {
+        SegmentUpdate &update = updateOf(*job, updates, SEGMENT_LIFTS, (*it)->getCode());
+        addToSnapshot(update.records, *it);
+        update.dropped.insert((*it)->getCode());
+        //moves still in the file saved before are copied from it by snapshotThread, without reading them here
+        update.movesFromBase.push_back((*it)->hasSavedMoves());
+        update.moves.emplace_back();
+        if (update.movesFromBase.back())
+            continue;
+        const vector<Moves> &movesHistory = (*it)->getMovesHistory();
+        vector<SnapshotMove> &moves = update.moves.back();
+        moves.resize(movesHistory.size());
+        for (unsigned int i = 0; i < movesHistory.size(); i++) {
+            moves[i].date = movesHistory[i].date.toKey();
+            moves[i].from = movesHistory[i].from;
+            moves[i].to = movesHistory[i].to;
+            moves[i].tInitial = movesHistory[i].tInitial.toSeconds();
+        }
+    }
+    for (vector<Client *>::iterator it = changedClients.begin(); it != changedClients.end(); it++) {
+        SegmentUpdate &update = updateOf(*job, updates, SEGMENT_CLIENTS, (*it)->getNif());
+        addToSnapshot(update.records, *it);
+        update.dropped.insert((*it)->getNif());
+    }
+    for (vector<Employee *>::iterator it = changedEmployees.begin(); it != changedEmployees.end(); it++) {
+        SegmentUpdate &update = updateOf(*job, updates, SEGMENT_EMPLOYEES, (*it)->getNif());
+        addToSnapshot(update.records, *it);
+        update.dropped.insert((*it)->getNif());
+    }
+
+    //the main file lists the segments that did not change now, snapshotThread adds the ones it writes
+    for (unsigned int k = 0; k < SEGMENT_NUMKINDS; k++)
+        for (unsigned int n = 0; n < segmentGenerations[k].size(); n++) {
+            SnapshotSegment segment = {k, n, segmentGenerations[k][n]};
+            if (segment.generation != 0 && updates.count(make_pair(k, n)) == 0)
+                job->manifest.segments.push_back(segment);
+        }
+    for (deque<SegmentUpdate>::iterator it = job->segments.begin(); it != job->segments.end(); it++)
+        if (it->baseGeneration != 0) {
+            SnapshotSegment segment = it->segment;
+            segment.generation = it->baseGeneration;
+            job->replaced.push_back(segment);
+        }
+
+    //what changes from now on goes to the next save
+    snapshotGeneration = generation;
+    snapshotSequence = job->manifest.journalSequence;
+    lastSnapshot = chrono::steady_clock::now();
+
+    {
+        lock_guard<mutex> lock(snapshotMutex);
+        snapshotJob = job;
+    }
+    snapshotChanged.notify_all();
+}
+
+void Pitch::writeSnapshots() {
+    unique_lock<mutex> lock(snapshotMutex);
+    while (true) {
+        //while there is no save to write, the journal entries waiting for a group are written once they are old enough,
+        //so the last changes before a crash are not lost when nothing is appended after them
+        if (!snapshotChanged.wait_for(lock, chrono::milliseconds(JOURNALGROUPMS), [this] {
+            return stopSnapshots || (snapshotJob != NULL && !snapshotJob->done);
+        })) {
+            lock.unlock();
+            journal.commitIfOld(); //a journal that could not be opened was already reported
+            lock.lock();
+            continue;
+        }
+        if (snapshotJob == NULL || snapshotJob->done)
+            return; //told to stop, with nothing left to write
+        SnapshotJob *job = snapshotJob;
+        lock.unlock();
+
+        //the segments are independent files, written at the same time; the main file goes last, once they are all there
+        unsigned int numThreads = segmentThreads(job->segments.size());
+        vector<future<bool> > writing;
+        for (unsigned int t = 0; t < numThreads; t++)
+            writing.push_back(async(launch::async, writeSegments, ref(*job), cref(snapshotFile), t, numThreads));
+        bool saved = true;
+        for (unsigned int t = 0; t < numThreads; t++)
+            saved = writing[t].get() && saved;
+        for (deque<SegmentUpdate>::iterator it = job->segments.begin(); saved && it != job->segments.end(); it++)
+            if (it->written) {
+                job->manifest.segments.push_back(it->segment);
+                job->bytes += it->records.size();
+            }
+        sort(job->manifest.segments.begin(), job->manifest.segments.end(), segmentOrder);
+        job->bytes += job->manifest.size();
+        saved = saved && job->manifest.write(snapshotFile);
+        //every file of the snapshot is on the disk once write returns, only then are the entries it has dropped from
+        //the journal; the entries left are skipped when loading, being in the snapshot
+        if (saved && !journal.truncate(job->journalBytes))
+            cerr << "Journal truncation failed.\n";
+
+        lock.lock();
+        job->saved = saved;
+        job->done = true;
+        snapshotChanged.notify_all();
+    }
+}
+
+bool Pitch::waitForSnapshot() {
+    SnapshotJob *job;
+    {
+        unique_lock<mutex> lock(snapshotMutex);
+        snapshotChanged.wait(lock, [this] { return snapshotJob == NULL || snapshotJob->done; });
+        job = snapshotJob;
+        snapshotJob = NULL;
+    }
+    if (job == NULL)
+        return true;
+
+    bool saved = job->saved;
+    if (saved) {
+        //the lifts of the segments just written read their moves from the new files, the replaced ones are not used
+        //anymore
+        for (deque<SegmentUpdate>::iterator it = job->segments.begin(); it != job->segments.end(); it++)
+            if (it->written && it->segment.kind == SEGMENT_LIFTS)
+                attachLiftSegment(it->segment, it->opened);
+        for (vector<SnapshotSegment>::iterator it = job->replaced.begin(); it != job->replaced.end(); it++) {
+            if (it->kind == SEGMENT_LIFTS && it->number < liftHistories.size() &&
+                liftHistories[it->number] != NULL && liftHistories[it->number]->getGeneration() == it->generation) {
+                delete liftHistories[it->number]; //a segment left without lifts, all of them removed and detached
+                liftHistories[it->number] = NULL;
+            }
+            remove(segmentPath(snapshotFile, *it).c_str());
+        }
+        rememberSegments(job->manifest.segments.data(), job->manifest.segments.size());
+        lastSaveBytes = job->bytes;
+    } else { //the files saved before are still the snapshot, what was in this save is saved again next time
+        for (deque<SegmentUpdate>::iterator it = job->segments.begin(); it != job->segments.end(); it++)
+            delete it->opened;
+        markAllChanged(); //the members copied may have been deleted since, so all of them are visited
+        removedMembers.insert(removedMembers.begin(), job->removed.begin(), job->removed.end());
+    }
+    delete job;
+    return saved;
+}
+
+void Pitch::attachLiftSegment(const SnapshotSegment &segment, SnapshotReader *reader) {
+    if (liftHistories.size() <= segment.number)
+        liftHistories.resize(segment.number + 1, NULL);
+    SnapshotReader *old = liftHistories[segment.number];
+    for (uint64_t i = 0; reader != NULL && i < reader->count(SNAPSHOT_LIFTS); i++) {
+        const SnapshotLift &rec = reader->lifts()[i];
+        Lift *l = findLift(rec.code);
+        if (l != NULL && l->isDirty()) //changed after the save was prepared, the file may not have all its moves
+            l->detachMoves();
+        else if (l != NULL)
+            l->attachMoves(reader->moves(rec), rec.numMoves);
+    }
+    //without the new file the lifts keep their moves in memory for good, since the old file is about to be closed
+    for (uint64_t i = 0; reader == NULL && old != NULL && i < old->count(SNAPSHOT_LIFTS); i++) {
+        Lift *l = findLift(old->lifts()[i].code);
+        if (l != NULL)
+            l->detachMoves();
+    }
+    delete old;
+    liftHistories[segment.number] = reader;
+}
+
+void Pitch::markAllSaved() {
+    vector<Maintenance *> savedMaintenances;
+    vector<Lift *> savedLifts;
+    vector<Client *> savedClients;
+    vector<Employee *> savedEmployees;
+    Maintenance::takeChanged(savedMaintenances);
+    Lift::takeChanged(savedLifts);
+    Client::takeChanged(savedClients);
+    Employee::takeChanged(savedEmployees);
+    removedMembers.clear();
+}
+
+void Pitch::markAllChanged() {
+    for (BSTItrIn<MaintenanceRecord> it(maintenances); !it.isAtEnd(); it.advance())
+        it.retrieve().getMaintenance()->markChanged();
+    for (vector<Lift *>::iterator it = lifts.begin(); it != lifts.end(); it++)
+        (*it)->markChanged();
+    for (HashTableClient::iterator it = clients.begin(); it != clients.end(); it++)
+        (*it)->markChanged();
+    for (vector<Employee *>::iterator it = employees.begin(); it != employees.end(); it++)
+        (*it)->markChanged();
+}
+void Pitch::rememberSegments(const SnapshotSegment *segments, uint64_t n) {
+    for (unsigned int k = 0; k < SEGMENT_NUMKINDS; k++)
+        segmentGenerations[k].clear();
+    for (uint64_t i = 0; i < n; i++) {
+        vector<uint64_t> &saved = segmentGenerations[segments[i].kind];
+        if (saved.size() <= segments[i].number)
+            saved.resize(segments[i].number + 1, 0);
+        saved[segments[i].number] = segments[i].generation;
+    }
+}
+
+bool Pitch::textFilesNewerThan(long long time) const {
+    return fileModificationTime(liftsFile) > time || fileModificationTime(clientsFile) > time ||
+           fileModificationTime(employeesFile) > time;
+}
+
+/**
+ * @return true if each maintenance segment starts after the one before it ends; the maintenances inside each one were
+ * already checked to be in order when it was opened
+ */
+static bool inOrder(const deque<SnapshotReader> &segments) {
+    const SnapshotMaintenance *last = NULL;
+    for (deque<SnapshotReader>::const_iterator it = segments.begin(); it != segments.end(); it++) {
+        uint64_t n = it->count(SNAPSHOT_MAINTENANCES);
+        if (n == 0)
+            continue;
+        if (last != NULL && treeKey(*last) >= treeKey(it->maintenances()[0]))
+            return false;
+        last = &it->maintenances()[n - 1];
+    }
+    return true;
+}
+
+bool Pitch::loadSnapshot() {
+    long long snapshotTime = fileModificationTime(snapshotFile);
+    if (snapshotTime < 0 || textFilesNewerThan(snapshotTime))
+        return false; //a text file edited after the snapshot was saved has the most recent information
+
+    SnapshotReader main;
+    if (!main.open(snapshotFile))
+        return false;
+    //every segment is opened, and so checked, before anything is built, all of them at the same time since each one is
+    //a file of its own. Maintenances come first since lifts and service providers refer to them, lifts before the
+    //clients that own them and clients before the employees associated to them. Lift segments stay open, lifts only
+    //read their moves from them when they are needed
+    deque<SnapshotReader> segments[SEGMENT_NUMKINDS];
+    vector<SnapshotReader *> histories;
+    vector<SnapshotReader *> readers;
+    vector<string> paths;
+    for (unsigned int kind = 0; kind < SEGMENT_NUMKINDS; kind++) {
+        for (uint64_t i = 0; i < main.count(SNAPSHOT_SEGMENTS); i++) {
+            const SnapshotSegment &segment = main.segments()[i];
+            if (segment.kind != kind)
+                continue;
+            SnapshotReader *reader;
+            if (kind == SEGMENT_LIFTS) {
+                if (histories.size() <= segment.number)
+                    histories.resize(segment.number + 1, NULL);
+                reader = new SnapshotReader();
+                delete histories[segment.number];
+                histories[segment.number] = reader;
+            } else {
+                segments[kind].emplace_back();
+                reader = &segments[kind].back();
+            }
+            readers.push_back(reader);
+            paths.push_back(segmentPath(snapshotFile, segment));
+        }
+    }
+    unsigned int numThreads = segmentThreads(readers.size());
+    vector<future<bool> > opening;
+    for (unsigned int t = 0; t < numThreads; t++)
+        opening.push_back(async(launch::async, openSegments, cref(readers), cref(paths), t, numThreads));
+    bool opened = true;
+    for (unsigned int t = 0; t < numThreads; t++)
+        opened = opening[t].get() && opened;
+    if (!opened || !inOrder(segments[SEGMENT_MAINTENANCES])) {
+        for (vector<SnapshotReader *>::iterator it = histories.begin(); it != histories.end(); it++)
+            delete *it;
+        return false;
+    }
+
+    vector<Maintenance *> byId;
+    loadSnapshotMaintenances(segments[SEGMENT_MAINTENANCES], byId);
+    liftHistories.swap(histories);
+    for (vector<SnapshotReader *>::iterator it = liftHistories.begin(); it != liftHistories.end(); it++)
+        if (*it != NULL)
+            loadSnapshotRecords(**it, byId);
+    for (unsigned int kind = SEGMENT_CLIENTS; kind < SEGMENT_NUMKINDS; kind++)
+        for (deque<SnapshotReader>::iterator it = segments[kind].begin(); it != segments[kind].end(); it++)
+            loadSnapshotRecords(*it, byId);
+    markAllSaved();
+
+    rememberSegments(main.segments(), main.count(SNAPSHOT_SEGMENTS));
+    snapshotGeneration = main.getGeneration();
+    snapshotSequence = main.getJournalSequence();
+    journal.skipTo(snapshotSequence);
+    return true;
+}
+
+void Pitch::loadSnapshotMaintenances(const deque<SnapshotReader> &segments, vector<Maintenance *> &byId) {
+    vector<MaintenanceRecord> all, pending;
+    for (deque<SnapshotReader>::const_iterator snap = segments.begin(); snap != segments.end(); snap++) {
+        for (uint64_t i = 0; i < snap->count(SNAPSHOT_MAINTENANCES); i++) {
+            const SnapshotMaintenance &rec = snap->maintenances()[i];
+            Maintenance *maintenance = fromSnapshot(rec);
+            maintenance->restoreId(rec.id);
+            if (byId.size() <= rec.id)
+                byId.resize(rec.id + 1, NULL);
+            byId[rec.id] = maintenance;
+            all.push_back(MaintenanceRecord(maintenance));
+            if (!maintenance->getFinished())
+                pending.push_back(MaintenanceRecord(maintenance));
+        }
+    }
+    //saved in the order of the trees, month after month, which are built balanced right away instead of one insertion
+    //at a time
+    maintenances.buildSorted(all);
+    pendingMaintenances.buildSorted(pending);
+}
+
+/**
+ * @return maintenance with the given id, NULL if there is none
+ */
+static Maintenance *maintenanceWithId(const vector<Maintenance *> &byId, uint32_t id) {
+    return id < byId.size() ? byId[id] : NULL;
+}
+
+void Pitch::loadSnapshotRecords(const SnapshotReader &snap, const vector<Maintenance *> &byId) {
+    for (uint64_t i = 0; i < snap.count(SNAPSHOT_LIFTS); i++) {
+        const SnapshotLift &rec = snap.lifts()[i];
+        Date install = Date::fromKey(rec.install);
+        Lift *newLift = new Lift(snap.str(rec.buildingName), snap.str(rec.address), rec.capacity, rec.clientNif,
+                                 rec.nFloors, install);
+        newLift->restoreCode(rec.code);
+        newLift->setPrice();
+        newLift->setRegularTime(rec.regularTime);
+        newLift->setHigherFloor(rec.higherFloor);
+        newLift->setLowerFloor(rec.lowerFloor);
+
+        newLift->attachMoves(snap.moves(rec), rec.numMoves);
+        newLift->doorOpens = 2 * rec.numMoves; //as many as reading the moves one by one would count
+        newLift->setCurrentFloor(rec.currentFloor);
+
+        const uint32_t *history = snap.refs() + rec.firstMaintenance;
+        for (unsigned int m = 0; m < rec.numMaintenances; m++) {
+            Maintenance *maintenance = maintenanceWithId(byId, history[m]);
+            if (maintenance != NULL)
+                newLift->addMaintenanceToMaintHistory(maintenance);
+        }
+
+        if (rec.clientNif == nif) {
+            ownedLifts.push_back(newLift);
+        }
+        lifts.push_back(newLift);
+        indexLift(newLift);
+    }
+
+    for (uint64_t i = 0; i < snap.count(SNAPSHOT_CLIENTS); i++) {
+        const SnapshotClient &rec = snap.clients()[i];
+        Client *newClient;
+        if (rec.entrepreneur) {
+            Entrepreneur *e = new Entrepreneur(snap.str(rec.name), rec.nif, Date::fromKey(rec.firstLift));
+            e->associateEmployee(rec.employeeNif);
+            newClient = e;
+        } else {
+            newClient = new ParticularClient(snap.str(rec.name), rec.nif, Date::fromKey(rec.firstLift));
+        }
+        const uint32_t *codes = snap.refs() + rec.firstLiftRef;
+        for (unsigned int l = 0; l < rec.numLifts; l++) {
+            Lift *owned = findLift(codes[l]);
+            if (owned != NULL)
+                newClient->purchaseNewLift(owned);
+        }
+        clients.insert(newClient);
+    }
+
+    for (uint64_t i = 0; i < snap.count(SNAPSHOT_EMPLOYEES); i++) {
+        const SnapshotEmployee &rec = snap.employees()[i];
+        if (rec.kind == '+') {
+            ServiceProvider *sp = new ServiceProvider(snap.str(rec.name), rec.nif, rec.age, rec.salary);
+            sp->setOldReviews(rec.evaluation, rec.numReviews);
+            sp->setHoursWorked(rec.hoursWorked);
+            sp->setNumMaintenances(rec.numMaintenances);
+            const uint32_t *schedule = snap.refs() + rec.firstRef;
+            for (unsigned int m = 0; m < rec.numRefs; m++) {
+                Maintenance *maintenance = maintenanceWithId(byId, schedule[m]);
+                if (maintenance != NULL)
+                    sp->scheduleMaintenance(maintenance);
+            }
+            employees.push_back(sp);
+            serviceProvidersByNif[sp->getNif()] = sp;
+            serviceProviders.push(ServiceProviderType(sp));
+            sp->attachCalendar(&calendar);
+        } else {
+            ContractedEmployee *ce = new ContractedEmployee(snap.str(rec.name), rec.nif, rec.age, rec.salary);
+            ce->setOldReviews(rec.evaluation, rec.numReviews);
+            const uint32_t *nifs = snap.refs() + rec.firstRef;
+            for (unsigned int c = 0; c < rec.numRefs; c++) {
+                Client *associated = findClient(nifs[c]);
+                if (associated != NULL)
+                    ce->associateToClient(associated);
+            }
+            employees.push_back(ce);
+            contractedEmployeesByNif[ce->getNif()] = ce;
+            contractedEmployees.push(ContractedEmployeeType(ce));
+            contractedEmployeesByLoad.push(ce);
+        }
+    }
+}
+
+Client *Pitch::searchClient(unsigned int searchedNIF) {
+    Client *found = findClient(searchedNIF);
+    if (found == NULL)
+        throw ClientDoesNotExist(searchedNIF);
+    return found;
+}
+
+Client *Pitch::findClient(unsigned int searchedNIF) const {
+    Client key(searchedNIF); //ClientHash only looks at the NIF, so a bare key is enough to probe the table
+    HashTableClient::const_iterator it = clients.find(&key);
+    if (it == clients.end())
+        return NULL;
+    return *it;
 }
 
 Employee *Pitch::searchClientsEmployee(unsigned int clientNIF) {
@@ -324,25 +1519,62 @@ Employee *Pitch::searchClientsEmployee(unsigned int clientNIF) {
 }
 
 Employee *Pitch::searchEmployee(unsigned int searchedNIF) {
-    for (unsigned int i = 0; i < employees.size(); i++) {
-        if (employees[i]->getNif() == searchedNIF) {
-            return employees[i];
-        }
-    }
-    throw EmployeeDoesNotExist(searchedNIF);
+    Employee *found = findEmployee(searchedNIF);
+    if (found == NULL)
+        throw EmployeeDoesNotExist(searchedNIF);
+    return found;
+}
+
+Employee *Pitch::findEmployee(unsigned int searchedNIF) const {
+    ServiceProvider *sp = findServiceProvider(searchedNIF);
+    if (sp != NULL)
+        return sp;
+    return findContractedEmployee(searchedNIF);
+}
+
+ServiceProvider *Pitch::findServiceProvider(unsigned int searchedNIF) const {
+    HashTableServiceProvider::const_iterator it = serviceProvidersByNif.find(searchedNIF);
+    if (it == serviceProvidersByNif.end())
+        return NULL;
+    return it->second;
+}
+
+ContractedEmployee *Pitch::findContractedEmployee(unsigned int searchedNIF) const {
+    HashTableContractedEmployee::const_iterator it = contractedEmployeesByNif.find(searchedNIF);
+    if (it == contractedEmployeesByNif.end())
+        return NULL;
+    return it->second;
 }
 
 Lift *Pitch::searchLift(unsigned int searchedCode) {
-    for (unsigned int i = 0; i < lifts.size(); i++) {
-        if (lifts[i]->getCode() == searchedCode) {
-            return lifts[i];
-        }
-    }
-    throw LiftDoesNotExist(searchedCode);
+    Lift *found = findLift(searchedCode);
+    if (found == NULL)
+        throw LiftDoesNotExist(searchedCode);
+    return found;
+}
+
+Lift *Pitch::findLift(unsigned int searchedCode) const {
+    if (searchedCode < FIRSTLIFTCODE || searchedCode - FIRSTLIFTCODE >= liftsByCode.size())
+        return NULL;
+    return liftsByCode[searchedCode - FIRSTLIFTCODE];
+}
+
+void Pitch::indexLift(Lift *toIndex) {
+    unsigned int slot = toIndex->getCode() - FIRSTLIFTCODE;
+    if (slot >= liftsByCode.size())
+        liftsByCode.resize(slot + 1, NULL); //codes of lifts never added (e.g. a declined purchase) stay as tombstones
+    liftsByCode[slot] = toIndex;
 }
 
 void Pitch::addClient(Client *toAdd) {
     clients.insert(toAdd);
+    toAdd->markChanged();
+
+    Entrepreneur *e = dynamic_cast<Entrepreneur *>(toAdd);
+    JournalEntry entry(JOURNAL_CLIENT_ADDED);
+    entry.putUnsigned(toAdd->getNif()).putUnsigned(e != NULL).putString(toAdd->getName())
+            .putDate(toAdd->getDateFirstLift()).putUnsigned(e != NULL ? e->getEmployeeNif() : 0);
+    record(entry);
 }
 
 void Pitch::addServiceProvider(ServiceProviderType spt) {
@@ -351,31 +1583,104 @@ void Pitch::addServiceProvider(ServiceProviderType spt) {
 
 void Pitch::addEmployee(string name, unsigned int nif, unsigned int age, double salary) {
     if (salary >= 365) {
-        ContractedEmployee *newcontractedEmployee = new ContractedEmployee(name, nif, age, salary);
-        Employee *newEmployee = dynamic_cast<Employee *>(newcontractedEmployee);
-        employees.push_back(newEmployee);
-        contractedEmployees.push(newcontractedEmployee);
+        registerEmployee(new ContractedEmployee(name, nif, age, salary));
+    } else {
+        registerEmployee(new ServiceProvider(name, nif, age, salary));
+    }
+}
+
+void Pitch::registerEmployee(Employee *toAdd) {
+    employees.push_back(toAdd);
+    toAdd->markChanged();
+    ContractedEmployee *ce = dynamic_cast<ContractedEmployee *>(toAdd);
+    ServiceProvider *sp = dynamic_cast<ServiceProvider *>(toAdd);
+    if (ce != NULL) {
+        contractedEmployeesByNif[ce->getNif()] = ce;
+        contractedEmployees.push(ce);
+        contractedEmployeesByLoad.push(ce);
     } else {
-        ServiceProvider *newSp = new ServiceProvider(name, nif, age, salary);
-        Employee *newEmployee = dynamic_cast<Employee *>(newSp);
-        employees.push_back(newEmployee);
-        serviceProviders.push(newSp);
+        serviceProvidersByNif[sp->getNif()] = sp;
+        serviceProviders.push(sp);
+        sp->attachCalendar(&calendar);
     }
+
+    JournalEntry entry(JOURNAL_EMPLOYEE_ADDED);
+    entry.putUnsigned(ce != NULL ? 'x' : '+').putString(toAdd->getName()).putUnsigned(toAdd->getNif())
+            .putUnsigned(toAdd->getAge()).putDouble(ce != NULL ? ce->getPerMonthSalary() : sp->getPerHourSalary());
+    record(entry);
+}
+
+void Pitch::forgetEmployee(Employee *toRm) {
+    unsigned int nif = toRm->getNif();
+    ServiceProvider *sp = dynamic_cast<ServiceProvider *>(toRm);
+    if (sp != NULL)
+        sp->detachCalendar();
+    vector<Employee *>::iterator pos = find(employees.begin(), employees.end(), toRm);
+    if (pos != employees.end())
+        employees.erase(pos);
+    serviceProvidersByNif.erase(nif);
+    contractedEmployeesByNif.erase(nif);
+    serviceProviders.erase(nif);
+    contractedEmployees.erase(nif);
+    contractedEmployeesByLoad.erase(nif);
+    markRemoved(SEGMENT_EMPLOYEES, nif, nif);
+
+    JournalEntry entry(JOURNAL_EMPLOYEE_REMOVED);
+    entry.putUnsigned(nif);
+    record(entry);
 }
 
 void Pitch::addLift(Lift *toAdd) {
     lifts.push_back(toAdd);
+    indexLift(toAdd);
+    toAdd->markChanged();
+
+    JournalEntry entry(JOURNAL_LIFT_ADDED);
+    entry.putUnsigned(toAdd->getCode()).putUnsigned(toAdd->getClientNif()).putString(toAdd->getName())
+            .putString(toAdd->getAddress()).putDate(toAdd->getInstallDate()).putUnsigned(toAdd->getCapacity())
+            .putUnsigned(toAdd->getNumFloors()).putInt(toAdd->getRegularTime()).putInt(toAdd->getCurrentFloor())
+            .putInt(toAdd->getHigherFloor()).putInt(toAdd->getLowerFloor());
+    record(entry);
+}
+
+void Pitch::removeLift(unsigned int code) {
+    Lift *toRm = searchLift(code);
+
+    Client *owner = findClient(toRm->getClientNif());
+    if (owner != NULL)
+        owner->removeLift(toRm);
+
+    vector<Lift *>::iterator it = find(ownedLifts.begin(), ownedLifts.end(), toRm);
+    if (it != ownedLifts.end())
+        ownedLifts.erase(it);
+    it = find(lifts.begin(), lifts.end(), toRm);
+    if (it != lifts.end())
+        lifts.erase(it);
+
+    liftsByCode[code - FIRSTLIFTCODE] = NULL;
+    markRemoved(SEGMENT_LIFTS, code, code);
+    toRm->detachMoves(); //its segment is saved again without it
+
+    JournalEntry entry(JOURNAL_LIFT_REMOVED);
+    entry.putUnsigned(code);
+    record(entry);
 }
 
 void Pitch::addMaintenance(Maintenance *maintenance) {
-    maintenances.insert(MaintenanceRecord(maintenance->getLiftCode(), maintenance->getMaintenanceDate(),
-                                          maintenance->getMaintenanceSchedule(), maintenance->getSpNIF()));
+    maintenances.insert(MaintenanceRecord(maintenance));
+    maintenance->markChanged();
+    if (!maintenance->getFinished())
+        pendingMaintenances.insert(MaintenanceRecord(maintenance));
 }
 
 unsigned int Pitch::getNif() const {
     return nif;
 }
 
+uint64_t Pitch::getLastSaveBytes() const {
+    return lastSaveBytes;
+}
+
 unsigned int Pitch::getNumEmployees() const {
     return employees.size();
 }
@@ -389,52 +1694,276 @@ vector<Lift *> Pitch::getLifts() {
 }
 
 void Pitch::automaticMaintenance(Lift *lift, Date today, Time time) {
-    ServiceProviderType sp(serviceProviders.top());
-    this->temporarilyRemoveEmployee(sp.getServiceProvider()->getNif());
-    Maintenance *m = new Maintenance(lift->getCode(), today, time, sp.getServiceProvider()->getNif());
-    MaintenanceRecord mr(m->getLiftCode(), m->getMaintenanceDate(), m->getMaintenanceSchedule(), m->getSpNIF());
-    maintenances.insert(mr);
-    sp.getServiceProvider()->scheduleMaintenance(m);
-    sp.getServiceProvider()->executeMaintenance();
-    this->addServiceProvider(sp);
+    executeAutomaticMaintenance(lift, serviceProviders.top().getServiceProvider(), today, time);
+}
+
+void Pitch::executeAutomaticMaintenance(Lift *lift, ServiceProvider *sp, Date today, Time time) {
+    Maintenance *m = new Maintenance(lift->getCode(), today, time, sp->getNif(), true);
+    maintenances.insert(MaintenanceRecord(m)); //executed right away, so it never goes into pendingMaintenances
+    m->markChanged();
+    sp->scheduleMaintenance(m);
+    sp->executeMaintenance(m);
+    serviceProviders.update(sp->getNif());
     lift->addMaintenanceToMaintHistory(m);
+
+    JournalEntry entry(JOURNAL_MAINTENANCE_AUTOMATIC);
+    entry.putUnsigned(lift->getCode()).putUnsigned(sp->getNif()).putDate(today).putTime(time);
+    record(entry);
+}
+
+void Pitch::moveMaintenance(Maintenance *m, ServiceProvider *to) {
+    unsigned int previous = m->getSpNIF();
+    ServiceProvider *from = findServiceProvider(previous);
+    if (from != NULL)
+        from->cancelMaintenance(m);
+    //the NIF is part of the key of the trees, so the maintenance is out of them while it changes
+    bool pending = pendingMaintenances.remove(MaintenanceRecord(m));
+    maintenances.remove(MaintenanceRecord(m));
+    m->setSpNIF(to->getNif());
+    maintenances.insert(MaintenanceRecord(m));
+    if (pending)
+        pendingMaintenances.insert(MaintenanceRecord(m));
+    to->scheduleMaintenance(m);
+
+    JournalEntry entry(JOURNAL_MAINTENANCE_REASSIGNED);
+    entry.putUnsigned(m->getLiftCode()).putUnsigned(previous).putDate(m->getMaintenanceDate())
+            .putTime(m->getMaintenanceSchedule()).putUnsigned(to->getNif());
+    record(entry);
+}
+
+void Pitch::cancelMaintenance(Maintenance *m) {
+    ServiceProvider *sp = findServiceProvider(m->getSpNIF());
+    if (sp != NULL)
+        sp->cancelMaintenance(m);
+    pendingMaintenances.remove(MaintenanceRecord(m));
+    maintenances.remove(MaintenanceRecord(m));
+    if (m->getId() != 0) //saved before, its segment is saved again without it
+        markRemoved(SEGMENT_MAINTENANCES, m->getMaintenanceDate().toKey(), m->getId());
+
+    JournalEntry entry(JOURNAL_MAINTENANCE_CANCELLED);
+    entry.putUnsigned(m->getLiftCode()).putUnsigned(m->getSpNIF()).putDate(m->getMaintenanceDate())
+            .putTime(m->getMaintenanceSchedule());
+    record(entry);
+}
+
+Maintenance *Pitch::assignMaintenance(unsigned int code, ServiceProvider *sp, Date appoint, Time sched) {
+    Maintenance *m = new Maintenance(code, appoint, sched, sp->getNif());
+    addMaintenance(m);
+    sp->scheduleMaintenance(m);
+
+    JournalEntry entry(JOURNAL_MAINTENANCE_SCHEDULED);
+    entry.putUnsigned(code).putUnsigned(sp->getNif()).putDate(appoint).putTime(sched);
+    record(entry);
+    return m;
 }
 
 
 bool Pitch::scheduleMaintenance(Lift *l, Time sched, Date appoint) {
-    heapEmployeesSP aux = serviceProviders;
-    ServiceProviderType sp(serviceProviders.top());
-    heapMaint aux_maint = sp.getServiceProvider()->getSchedule();
-    bool available = true;
-    while (!aux.empty()) {
-        sp = serviceProviders.top();
-        heapMaint aux_maint = sp.getServiceProvider()->getSchedule();
-        available = true;
-        while (!aux_maint.empty()) {
-            if (((aux_maint.top()->getMaintenanceSchedule() <= sched) &&
-                 (sched <= aux_maint.top()->getMaintenanceSchedule() + aux_maint.top()->getMaintenanceDuration())) &&
-                aux_maint.top()->getMaintenanceDate() == appoint) {
-                available = false;
-            } else if (((aux_maint.top()->getMaintenanceSchedule() > sched) &&
-                        (aux_maint.top()->getMaintenanceSchedule() <=
-                         sched + aux_maint.top()->getMaintenanceSchedule())) &&
-                       aux_maint.top()->getMaintenanceDate() == appoint) {
-                available = false;
+    Timestamp start = toTimestamp(appoint, sched);
+    vector<uint64_t> maybeBusy, surelyBusy; //one bit per service provider, see SlotCalendar::busyAt
+    calendar.busyAt(start, maybeBusy, surelyBusy);
+    //of the service providers free at that moment, the one nearest the top of serviceProviders, found without copying it
+    const vector<ServiceProviderType> &candidates = serviceProviders.elements();
+    const ServiceProviderType *chosen = NULL;
+    for (vector<ServiceProviderType>::const_iterator it = candidates.begin(); it != candidates.end(); it++) {
+        if (chosen != NULL && !(*chosen < *it))
+            continue;
+        ServiceProvider *sp = it->getServiceProvider();
+        unsigned int column = sp->getCalendarColumn();
+        if ((surelyBusy[column / 64] >> (column % 64) & 1) != 0)
+            continue;
+        if ((maybeBusy[column / 64] >> (column % 64) & 1) == 0 || sp->isAvailable(start))
+            chosen = &(*it);
+    }
+    if (chosen == NULL)
+        return false;
+    assignMaintenance(l->getCode(), chosen->getServiceProvider(), appoint, sched);
+    return true;
+}
+
+/** position of the lowest bit set in x, which must not be 0 */
+static unsigned int lowestBit(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    unsigned int i = 0;
+    for (; (x & 1) == 0; x >>= 1)
+        i++;
+    return i;
+#endif
+}
+
+void Pitch::calendarColumns(vector<ServiceProvider *> &byColumn, vector<uint64_t> &eligible) const {
+    const vector<ServiceProviderType> &candidates = serviceProviders.elements();
+    for (vector<ServiceProviderType>::const_iterator it = candidates.begin(); it != candidates.end(); it++) {
+        ServiceProvider *sp = it->getServiceProvider();
+        unsigned int column = sp->getCalendarColumn();
+        if (byColumn.size() <= column) {
+            byColumn.resize(column + 1, NULL);
+            eligible.resize(column / 64 + 1, 0);
+        }
+        byColumn[column] = sp;
+        eligible[column / 64] |= (uint64_t) 1 << (column % 64);
+    }
+}
+
+vector<unsigned int> Pitch::scheduleBatch(const vector<MaintenanceRequest> &requests) {
+    //the service providers that can be given work, by their column in the calendar, and how loaded each one is
+    vector<ServiceProvider *> byColumn;
+    vector<uint64_t> eligible;
+    calendarColumns(byColumn, eligible);
+    vector<unsigned int> load(byColumn.size(), 0);
+    for (unsigned int column = 0; column < byColumn.size(); column++) {
+        if (byColumn[column] != NULL) //the same measure reassignMaintenances uses: maintenances done and scheduled
+            load[column] = byColumn[column]->getNumMaintenancesDone() + byColumn[column]->getNumAppointments();
+    }
+
+    vector<unsigned int> unassigned;
+    vector<uint64_t> maybeBusy, surelyBusy;
+    for (unsigned int r = 0; r < requests.size(); r++) {
+        const MaintenanceRequest &request = requests[r];
+        ServiceProvider *chosen = NULL;
+        unsigned int chosenColumn = 0;
+        Time chosenTime;
+        for (unsigned int t = request.earliest.toSeconds();
+             request.lift != NULL && chosen == NULL && t <= request.latest.toSeconds(); t += SLOTSECONDS) {
+            Time sched = Time::fromSeconds(t);
+            Timestamp start = toTimestamp(request.day, sched);
+            calendar.busyAt(start, maybeBusy, surelyBusy);
+            for (unsigned int group = 0; group < eligible.size(); group++) {
+                //only the service providers that may be free are visited, one bit at a time
+                for (uint64_t left = eligible[group] & ~surelyBusy[group]; left != 0; left &= left - 1) {
+                    unsigned int column = group * 64 + lowestBit(left);
+                    ServiceProvider *sp = byColumn[column];
+                    if (chosen != NULL && (load[column] > load[chosenColumn] ||
+                                           (load[column] == load[chosenColumn] &&
+                                            sp->getEvaluation() <= chosen->getEvaluation())))
+                        continue;
+                    if ((maybeBusy[group] >> (column % 64) & 1) != 0 && !sp->isAvailable(start))
+                        continue;
+                    chosen = sp;
+                    chosenColumn = column;
+                    chosenTime = sched;
+                }
             }
-            aux_maint.pop();
-        }
-        if (available) {
-            this->temporarilyRemoveEmployee(sp.getServiceProvider()->getNif());
-            Maintenance *m = new Maintenance(l->getCode(), appoint, sched, sp.getServiceProvider()->getNif());
-            MaintenanceRecord mr(m->getLiftCode(), m->getMaintenanceDate(), m->getMaintenanceSchedule(), m->getSpNIF());
-            maintenances.insert(mr);
-            sp.getServiceProvider()->scheduleMaintenance(m);
-            this->addServiceProvider(sp);
+        }
+        if (chosen == NULL) {
+            unassigned.push_back(r);
+            continue;
+        }
+        assignMaintenance(request.lift->getCode(), chosen, request.day, chosenTime);
+        load[chosenColumn]++;
+    }
+    return unassigned;
+}
+
+/**
+ * Orders columns of the calendar by the work of their service providers, the least loaded first, and the best
+ * evaluated first on a tie
+ */
+struct LessLoaded {
+    const vector<unsigned int> &load;
+    const vector<unsigned int> &evaluation;
+
+    LessLoaded(const vector<unsigned int> &load, const vector<unsigned int> &evaluation) : load(load),
+                                                                                           evaluation(evaluation) {}
+
+    bool operator()(unsigned int a, unsigned int b) const {
+        if (load[a] != load[b])
+            return load[a] < load[b];
+        return evaluation[a] > evaluation[b];
+    }
+};
+
+/**
+ * Looks for a service provider for the maintenance at position m of a group, by an augmenting path: a free one, or one
+ * given to another maintenance of the group that can be given to some other service provider instead
+ * @param candidates service providers free for each maintenance of the group, by position in the group
+ * @param matchOf maintenance given to each service provider, by column, valid if matchStamp is stamp
+ * @param visited stamp of the last search that went through each service provider, by column
+ * @return true if the maintenance got a service provider
+ */
+static bool augment(unsigned int m, const vector<vector<unsigned int> > &candidates, vector<unsigned int> &matchOf,
+                    vector<unsigned int> &matchStamp, vector<unsigned int> &visited, unsigned int stamp,
+                    unsigned int search) {
+    for (vector<unsigned int>::const_iterator it = candidates[m].begin(); it != candidates[m].end(); it++) {
+        if (visited[*it] == search)
+            continue;
+        visited[*it] = search;
+        if (matchStamp[*it] != stamp ||
+            augment(matchOf[*it], candidates, matchOf, matchStamp, visited, stamp, search)) {
+            matchOf[*it] = m;
+            matchStamp[*it] = stamp;
             return true;
         }
-        aux.pop();
     }
-    return available;
+    return false;
+}
+
+vector<Maintenance *> Pitch::reassignMaintenances(const vector<Maintenance *> &toReassign) {
+    vector<Maintenance *> sorted(toReassign);
+    sort(sorted.begin(), sorted.end(), MaintenanceStartOrder());
+
+    vector<ServiceProvider *> byColumn;
+    vector<uint64_t> eligible;
+    calendarColumns(byColumn, eligible);
+    //maintenances, done or scheduled, and evaluation of each service provider
+    vector<unsigned int> load(byColumn.size(), 0), evaluation(byColumn.size(), 0);
+    for (unsigned int column = 0; column < byColumn.size(); column++) {
+        if (byColumn[column] != NULL) {
+            load[column] = byColumn[column]->getNumMaintenancesDone() + byColumn[column]->getNumAppointments();
+            evaluation[column] = byColumn[column]->getEvaluation();
+        }
+    }
+    vector<unsigned int> matchOf(byColumn.size()), matchStamp(byColumn.size(), 0), visited(byColumn.size(), 0);
+    unsigned int stamp = 0, search = 0;
+
+    vector<Maintenance *> unplaced;
+    vector<uint64_t> maybeBusy, surelyBusy;
+    for (size_t first = 0; first < sorted.size();) {
+        //maintenances that all overlap one another, those starting at most a duration after the first one (touching
+        //ends count, as in ServiceProvider::isAvailable), are matched together; one overlapping only some of them
+        //starts the next group, matched once this one is placed
+        size_t last = first + 1;
+        while (last < sorted.size() && sorted[last]->getStart() - sorted[first]->getStart() <= MAINTDURATION_SECONDS)
+            last++;
+
+        //the service providers free for each maintenance of the group; as many as there are maintenances in the group
+        //are put first, the least loaded ones, to be tried before the others
+        vector<vector<unsigned int> > candidates(last - first);
+        for (size_t m = first; m < last; m++) {
+            Timestamp start = sorted[m]->getStart();
+            calendar.busyAt(start, maybeBusy, surelyBusy);
+            vector<unsigned int> &free = candidates[m - first];
+            for (unsigned int group = 0; group < eligible.size(); group++) {
+                for (uint64_t left = eligible[group] & ~surelyBusy[group]; left != 0; left &= left - 1) {
+                    unsigned int column = group * 64 + lowestBit(left);
+                    if ((maybeBusy[group] >> (column % 64) & 1) == 0 || byColumn[column]->isAvailable(start))
+                        free.push_back(column);
+                }
+            }
+            partial_sort(free.begin(), free.begin() + min(free.size(), last - first), free.end(),
+                         LessLoaded(load, evaluation));
+        }
+
+        stamp++;
+        vector<bool> placed(last - first, false);
+        for (size_t m = 0; m < last - first; m++)
+            augment(m, candidates, matchOf, matchStamp, visited, stamp, ++search);
+        for (unsigned int column = 0; column < byColumn.size(); column++) {
+            if (matchStamp[column] == stamp) {
+                moveMaintenance(sorted[first + matchOf[column]], byColumn[column]);
+                placed[matchOf[column]] = true;
+                load[column]++;
+            }
+        }
+        for (size_t m = 0; m < last - first; m++) {
+            if (!placed[m])
+                unplaced.push_back(sorted[first + m]);
+        }
+        first = last;
+    }
+    return unplaced;
 }
 
 Employee *Pitch::getMostReviewedEmployee() {
@@ -487,19 +2016,35 @@ Employee *Pitch::getWorstEvaluatedEmployee() {
 }
 
 Employee *Pitch::getEmployeeWithLessClientsAssociated() {
-    vector<Employee *> onlyContracted;
-    for (vector<Employee *>::iterator it = employees.begin(); it != employees.end(); it++) {
-        ContractedEmployee *newCE = dynamic_cast<ContractedEmployee *>((*it));
-        if (newCE != NULL) {
-            onlyContracted.push_back(newCE);
-        }
+    if (contractedEmployeesByLoad.empty()) return NULL;
+    return contractedEmployeesByLoad.top().getContractedEmployee();
+}
+
+void Pitch::redistributeClients(ContractedEmployee *from) {
+    contractedEmployeesByLoad.erase(from->getNif());
+    if (contractedEmployeesByLoad.empty()) return; //there is no one left to take his clients
+
+    vector<Client *> toMove = from->getClientsAssociated();
+    for (vector<Client *>::iterator it = toMove.begin(); it != toMove.end(); it++)
+        associate(*it, contractedEmployeesByLoad.top().getContractedEmployee());
+}
+
+void Pitch::associate(Client *c, ContractedEmployee *ce) {
+    ce->associateToClient(c);
+    Entrepreneur *ent = dynamic_cast<Entrepreneur *>(c);
+    if (ent != NULL) {
+        ent->associateEmployee(ce->getNif());
     }
-    sort(onlyContracted.begin(), onlyContracted.end(), sortEmployeesByNumClientsAssociated);
-    return onlyContracted[0];
+    contractedEmployeesByLoad.update(ce->getNif());
+    contractedEmployees.update(ce->getNif()); //the number of clients is the tiebreaker of that queue
+
+    JournalEntry entry(JOURNAL_CLIENT_ASSOCIATED);
+    entry.putUnsigned(c->getNif()).putUnsigned(ce->getNif());
+    record(entry);
 }
 
 ContractedEmployee *Pitch::getEmployeeAssociatedToEntrepreneur(Entrepreneur *e) {
-    return dynamic_cast<ContractedEmployee *>(searchClientsEmployee(e->getNif()));
+    return findContractedEmployee(e->getEmployeeNif());
 }
 
 Client *Pitch::getOldestClient() {
@@ -551,166 +2096,86 @@ Client *Pitch::getClientAssociatedToLift(Lift *l) {
     }
 }
 
-void Pitch::removeEmployee(unsigned int nif) {
+vector<Maintenance *> Pitch::removeEmployee(unsigned int nif) {
+    vector<Maintenance *> unplaced;
     try {
         //REMOVING A CONTRACTED EMPLOYEE
-        ContractedEmployee *toRm = dynamic_cast<ContractedEmployee *>(searchEmployee(nif));
+        Employee *removed = searchEmployee(nif);
+        ContractedEmployee *toRm = findContractedEmployee(nif);
         if (toRm != NULL) { //the employee we are trying to remove is a contracted employee
-            vector<Client *> copy = toRm->getClientsAssociated();
-            for (unsigned int i = 0; i < copy.size(); i++) {
-                ContractedEmployee *ce = dynamic_cast<ContractedEmployee *>(getEmployeeWithLessClientsAssociated());
-                ce->associateToClient(
-                        copy[i]); //therefore each one of his clients need to be associated to other contracted employee
-                Entrepreneur *ent = dynamic_cast<Entrepreneur *>(copy[i]); //the client associated to the employee to be removed was indeed an entrepreneur
-                if (ent != NULL) {
-                    ent->associateEmployee(
-                            ce->getNif()); //therefore we also need to set the new associated to the entrepreneur employee's nif
-                }
-            }
-
             //removing the contracted employee from the queue as well
-            heapEmployeesCE temp;
-            while (!contractedEmployees.empty()) {
-                if (contractedEmployees.top().getContractedEmployee() == toRm) {
-                    //not to preserve
-                } else {
-                    temp.push(contractedEmployees.top());
-                }
-                contractedEmployees.pop();
-            }
-            contractedEmployees = temp;
+            contractedEmployees.erase(nif);
+            //each one of his clients needs to be associated to other contracted employee
+            redistributeClients(toRm);
         } else {
             //REMOVING A SERVICE PROVIDER
-            ServiceProvider *toRm = dynamic_cast<ServiceProvider *>(searchEmployee(nif));
+            ServiceProvider *toRm = findServiceProvider(nif);
             if (toRm != NULL) {
-                vector<Maintenance *> maintsToReassign;
-                if (toRm->getNumAppointments() !=
-                    0) { //the service provider has scheduled maintenances that need to be reassigned
-                    heapMaint temp = toRm->getSchedule();
-                    while (!temp.empty()) {
-                        maintsToReassign.push_back(temp.top());
-                        temp.pop();
-                    }
-                }
-
                 //removing the service provider from the queue to prevent him from interfere with the reassignment
-                heapEmployeesSP temp;
-                while (!serviceProviders.empty()) {
-                    if (serviceProviders.top().getServiceProvider() == toRm) {
-                        //not to preserve
-                    } else {
-                        temp.push(serviceProviders.top());
-                    }
-                    serviceProviders.pop();
-                }
-                serviceProviders = temp;
+                serviceProviders.erase(nif);
 
                 //reassigning the maintenances that the service provider just removed had in hands
-                vector<Maintenance *>::iterator it = maintsToReassign.begin();
-                while (!maintsToReassign.empty()) {
-                    Employee *emp = serviceProviders.top().getServiceProvider();
-                    serviceProviders.pop();
-                    ServiceProvider *sp;
-                    sp = dynamic_cast<ServiceProvider *>(emp);
-                    bool completed = sp->scheduleMaintenance(*it);
-                    if (completed) {
-                        maintsToReassign.erase(
-                                it); //task was reassign, it is incremented automatically because of the erase operation
-                    } else { //we ignore by now the fact that the maintenance failed to be reassigned and will come back to it later
-                        it++;
-                        if (it ==
-                            maintsToReassign.end()) { //eventually we will have traversed all maintenances and need to restart
-                            it = maintsToReassign.begin();
-                        }
-                    }
-                    serviceProviders.push(
-                            sp); //the service provider is pushed again into the queue whether the maintenance was assigned to him or not
-                }
+                const Agenda &schedule = toRm->getSchedule();
+                unplaced = reassignMaintenances(vector<Maintenance *>(schedule.begin(), schedule.end()));
+                //nobody would execute them once he is gone
+                for (vector<Maintenance *>::iterator it = unplaced.begin(); it != unplaced.end(); it++)
+                    cancelMaintenance(*it);
             }
         }
 
-        //removing the employee, whatever is his type, from the vector
-        if (binarySearch(employees, searchEmployee(nif)) != -1) {
-            employees.erase(employees.begin() + SequentialSearch(employees, searchEmployee(nif)));
-        } //there is no need to worry about an else condition because if employee does not exist, that exception will be catched
+        //removing the employee, whatever is his type, from the vector, the directory and the queues
+        forgetEmployee(removed);
     }
     catch (EmployeeDoesNotExist &exc) {
         cout << exc.what();
     }
+    return unplaced;
 }
 
 void Pitch::temporarilyRemoveEmployee(unsigned int nif) {
-    ContractedEmployee *toRm = dynamic_cast<ContractedEmployee *>(searchEmployee(nif));
+    ContractedEmployee *toRm = findContractedEmployee(nif);
     if (toRm != NULL) {
-        //removing the contracted employee from the queue as well
-        heapEmployeesCE temp;
-        while (!contractedEmployees.empty()) {
-            if (contractedEmployees.top().getContractedEmployee() == toRm) {
-                //not to preserve
-            } else {
-                temp.push(contractedEmployees.top());
-            }
-            contractedEmployees.pop();
-        }
-        contractedEmployees = temp;
-
+        //removing the contracted employee from the queues as well
+        contractedEmployees.erase(nif);
+        contractedEmployeesByLoad.erase(nif);
     } else {
-        ServiceProvider *toRm = dynamic_cast<ServiceProvider *>(searchEmployee(nif));
-        if (toRm !=
-            NULL) {//removing the service provider from the queue to prevent him from interfere with the reassignment
-            heapEmployeesSP temp;
-            while (!serviceProviders.empty()) {
-                if (serviceProviders.top().getServiceProvider() == toRm) {
-                    //not to preserve
-                } else {
-                    temp.push(serviceProviders.top());
-
-                }
-                serviceProviders.pop();
-            }
-            serviceProviders = temp;
-        }
+        //removing the service provider from the queue to prevent him from interfere with the reassignment
+        serviceProviders.erase(nif);
     }
 
 }
 
 void Pitch::removeClient(unsigned int nif) {
-    try {
-        searchClient(nif);
-    }
-    catch (ClientDoesNotExist &exc) {
-        exc.what();
-    }
+    Client *toRm = searchClient(nif);
 
-    vector<Lift *> thisClientLifts = searchClient(nif)->getLifts();
+    vector<Lift *> thisClientLifts = toRm->getLifts();
     for (vector<Lift *>::iterator it = thisClientLifts.begin(); it != thisClientLifts.end(); it++) {
         (*it)->setOwner(this->nif);
         ownedLifts.push_back((*it));
     }
 
-    Client *ent = (searchClient(nif));
-    if (ent->getNif() > minEntrepeneurNif) {
-        Entrepreneur *e = dynamic_cast<Entrepreneur *>(ent);
-        ContractedEmployee *ce = dynamic_cast<ContractedEmployee *>(searchEmployee(e->getEmployeeNif()));
-        ce->removeClient(searchClient(nif));
-    }
-
-    for (HashTableClient::iterator it = clients.begin(); it != clients.end(); it++) {
-        if ((*it)->getNif() == nif) {
-            clients.erase(it);
-            break;
+    if (toRm->getNif() > minEntrepeneurNif) {
+        Entrepreneur *e = dynamic_cast<Entrepreneur *>(toRm);
+        ContractedEmployee *ce = findContractedEmployee(e->getEmployeeNif());
+        if (ce != NULL) {
+            ce->removeClient(toRm);
+            contractedEmployeesByLoad.update(ce->getNif());
+            contractedEmployees.update(ce->getNif());
         }
     }
+
+    clients.erase(toRm);
+    markRemoved(SEGMENT_CLIENTS, nif, nif);
+
+    JournalEntry entry(JOURNAL_CLIENT_REMOVED);
+    entry.putUnsigned(nif);
+    record(entry);
 }
 
 void Pitch::associateEmployeeToClient(Client *c) {
     Entrepreneur *newEntrep = dynamic_cast<Entrepreneur *>(c);
     if (newEntrep != NULL) {
-        Employee *e = getEmployeeWithLessClientsAssociated();
-        ContractedEmployee *ce = dynamic_cast<ContractedEmployee *>(e);
-
-        newEntrep->associateEmployee(ce->getNif());
-        ce->associateToClient(c);
+        associate(c, contractedEmployeesByLoad.top().getContractedEmployee());
     } else {
         throw NotAnEntrepreneur(c->getNif());
     }
@@ -788,53 +2253,89 @@ void Pitch::showLiftMaintenanceHist(Lift *l) {
 }
 
 int Pitch::registerMove(Lift &lift, int op2, Date today, Time now) {
-    lift.readMove(lift.getCurrentFloor(), op2, today, now);
+    int from = lift.getCurrentFloor();
+    lift.readMove(from, op2, today, now);
+
+    JournalEntry entry(JOURNAL_MOVE);
+    entry.putUnsigned(lift.getCode()).putInt(from).putInt(op2).putDate(today).putTime(now);
+    record(entry);
     return 0;
 }
 
 bool Pitch::employeeExists(unsigned int nif) {
-    try {
-        searchEmployee(nif);
-    }
-    catch (EmployeeDoesNotExist &e) {
-        return false;
-    }
-    return true;
+    return findEmployee(nif) != NULL;
 }
 
 void Pitch::addContractedEmployee(ContractedEmployee *e) {
+    if (findContractedEmployee(e->getNif()) == NULL) {
+        registerEmployee(e);
+        return;
+    }
+    //after a review the employee is only being put back in the queues
     contractedEmployees.push(e);
-    employees.push_back(e);
+    contractedEmployeesByLoad.push(e);
+}
+
+void Pitch::reviewMaintenance(ServiceProvider *reviewed, unsigned int eva) {
+    reviewed->review(eva);
+    serviceProviders.update(reviewed->getNif());
+
+    JournalEntry entry(JOURNAL_EMPLOYEE_REVIEWED);
+    entry.putUnsigned(reviewed->getNif()).putUnsigned(eva);
+    record(entry);
+}
+
+void Pitch::reviewContractedEmployee(ContractedEmployee *reviewed, unsigned int eva) {
+    reviewed->review(eva);
+    contractedEmployees.update(reviewed->getNif());
+
+    JournalEntry entry(JOURNAL_EMPLOYEE_REVIEWED);
+    entry.putUnsigned(reviewed->getNif()).putUnsigned(eva);
+    record(entry);
 }
 
 void Pitch::updateMaintenances(Time actualTime, Date actualDate) {
-    ServiceProvider *sp;
-    BSTItrIn<MaintenanceRecord> itrIn(maintenances);
-    while (!itrIn.isAtEnd()) {
-        if (itrIn.retrieve().getMaintenance()->getMaintenanceDate() < actualDate &&
-            !itrIn.retrieve().getMaintenance()->getFinished()) {
-            itrIn.retrieve().getMaintenance()->setFinished(true);
-            searchLift(itrIn.retrieve().getMaintenance()->getLiftCode())->addMaintenanceToMaintHistory(
-                    itrIn.retrieve().getMaintenance());
-            sp = dynamic_cast<ServiceProvider *> (searchEmployee(itrIn.retrieve().getMaintenance()->getSpNIF()));
-            sp->executeMaintenance();
-            this->temporarilyRemoveEmployee(sp->getNif());
-            this->addServiceProvider(sp);
-        } else if (itrIn.retrieve().getMaintenance()->getMaintenanceDate() == actualDate &&
-                   !itrIn.retrieve().getMaintenance()->getFinished()) {
-            if (itrIn.retrieve().getMaintenance()->getMaintenanceSchedule() < actualTime) {
-                itrIn.retrieve().getMaintenance()->setFinished(true);
-                searchLift(itrIn.retrieve().getMaintenance()->getLiftCode())->addMaintenanceToMaintHistory(
-                        itrIn.retrieve().getMaintenance());
-                sp = dynamic_cast<ServiceProvider *> (searchEmployee(itrIn.retrieve().getMaintenance()->getSpNIF()));
-                sp->executeMaintenance();
-                this->temporarilyRemoveEmployee(sp->getNif());
-                this->addServiceProvider(sp);
-            }
+    //every pending maintenance sorts before this key exactly when it was scheduled before the actual date and time
+    Maintenance now(0, actualDate, actualTime, 0);
+    MaintenanceRecord limit(&now);
+
+    vector<Maintenance *> due;
+    for (BSTItrIn<MaintenanceRecord> itrIn(pendingMaintenances); !itrIn.isAtEnd() && itrIn.retrieve() < limit; itrIn.advance())
+        due.push_back(itrIn.retrieve().getMaintenance());
+
+    for (vector<Maintenance *>::iterator it = due.begin(); it != due.end(); it++) {
+        ServiceProvider *sp = findServiceProvider((*it)->getSpNIF());
+        if (sp == NULL) { //no one left to execute it
+            cancelMaintenance(*it);
+            continue;
         }
-        itrIn.advance();
+        pendingMaintenances.remove(MaintenanceRecord(*it));
+        (*it)->setFinished(true);
+        Lift *maintained = findLift((*it)->getLiftCode());
+        if (maintained != NULL) //the lift may have been removed after the maintenance was scheduled
+            maintained->addMaintenanceToMaintHistory(*it);
+        sp->executeMaintenance(*it);
+        serviceProviders.update(sp->getNif());
     }
-}
-
 
+    if (!due.empty()) {
+        JournalEntry entry(JOURNAL_MAINTENANCES_UPDATED);
+        entry.putDate(actualDate).putTime(actualTime);
+        record(entry);
+    }
+}
 
+vector<Maintenance *> Pitch::getMaintenancesBetween(Date from, Date to) {
+    vector<Maintenance *> inRange;
+    if (to < from)
+        return inRange;
+    Maintenance first(0, from, Time(0, 0, 0), 0); //sorts before every maintenance of that day
+    Maintenance last(UINT_MAX, to, Time(23, 59, 59), UINT_MAX); //sorts after every maintenance of that day
+    //the range ends at the first maintenance after it, found once instead of comparing dates at every step
+    BSTItrIn<MaintenanceRecord> after = maintenances.upperBound(MaintenanceRecord(&last));
+    Maintenance *stop = after.isAtEnd() ? NULL : after.retrieve().getMaintenance();
+    for (BSTItrIn<MaintenanceRecord> itrIn = maintenances.lowerBound(MaintenanceRecord(&first));
+         !itrIn.isAtEnd() && itrIn.retrieve().getMaintenance() != stop; itrIn.advance())
+        inRange.push_back(itrIn.retrieve().getMaintenance());
+    return inRange;
+}
@@ -6,14 +6,25 @@
 #include "Client.h"
 #include "Employee.h"
 #include "bst.h"
+#include "heap.h"
+#include "Snapshot.h"
+#include "Journal.h"
 #include <queue>
+#include <deque>
+#include <map>
 #include <unordered_set>
+#include <unordered_map>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 using namespace std;
 
-typedef priority_queue<ServiceProviderType> heapEmployeesSP;
-typedef priority_queue<ContractedEmployeeType> heapEmployeesCE;
+typedef IndexedHeap<ServiceProviderType> heapEmployeesSP;
+typedef IndexedHeap<ContractedEmployeeType> heapEmployeesCE;
+typedef IndexedHeap<ContractedEmployeeLoadType> heapEmployeesLoad;
 
 struct ClientHash {
     int operator()(const Client *c) const {
@@ -29,7 +40,70 @@ struct ClientHash {
     }
 };
 
+/** lifts read from the lifts file, with the maintenances of their histories, not yet added to Pitch */
+struct ParsedLifts {
+    vector<Lift *> lifts;
+    vector<Maintenance *> maintenances;
+};
+
+/** clients read from the clients file, not yet added to Pitch */
+struct ParsedClients {
+    vector<Client *> clients;
+    vector<vector<unsigned int> > liftCodes; /** codes of the lifts of each client */
+};
+
+/** employees read from the employees file, not yet added to Pitch */
+struct ParsedEmployees {
+    vector<Employee *> employees;
+    vector<Maintenance *> maintenances; /** scheduled by the service providers */
+    vector<vector<unsigned int> > clientNifs; /** NIFs of the clients of each contracted employee, empty for service providers */
+};
+
+/** maintenance asked for a lift, to start on the given day at some moment between earliest and latest */
+struct MaintenanceRequest {
+    Lift *lift;
+    Date day;
+    Time earliest;
+    Time latest;
+};
+
+/** member taken out of Pitch since the last snapshot save, left out of its segment by the next one */
+struct RemovedMember {
+    SnapshotSegmentKind kind;
+    unsigned int segmentKey; /** what the segment of the member is found from, see Pitch::markRemoved */
+    uint32_t key; /** code of the lift, NIF of the client or employee or id of the maintenance */
+};
+
+/**
+ * segment rewritten by a save: copies of its members that changed, made when the save is prepared, to which
+ * snapshotThread adds the ones that did not change, read from the file of the segment saved before
+ */
+struct SegmentUpdate {
+    SnapshotSegment segment; /** with the generation of the save */
+    uint64_t baseGeneration = 0; /** generation of the file of the segment saved before, 0 if there is none */
+    SnapshotWriter records; /** records of the members that changed; the moves of the lifts are added by snapshotThread */
+    vector<bool> movesFromBase; /** for each lift in records, if its moves are the ones in the file saved before */
+    vector<vector<SnapshotMove> > moves; /** for each lift in records, its moves, if they are not in that file */
+    unordered_set<uint32_t> dropped; /** codes, NIFs or ids of the members of that file that are not copied from it */
+    bool written = false; /** the segment was written, it was not left without members */
+    SnapshotReader *opened = NULL; /** lift segment written, opened for its lifts to read their moves from */
+};
+
+/** snapshot save prepared by the thread that changes Pitch and written by the snapshot thread */
+struct SnapshotJob {
+    deque<SegmentUpdate> segments; /** the segments that changed */
+    vector<SnapshotSegment> replaced; /** segments whose old files can be removed once the main file lists the new ones */
+    SnapshotWriter manifest; /** main file, listing the segments that did not change until snapshotThread adds the others */
+    vector<RemovedMember> removed; /** members left out of segments, left out again by the next save if this one fails */
+    uint64_t journalBytes = 0; /** size of the journal when the save was prepared, its entries are all in the save */
+    uint64_t bytes = 0; /** size of the files written */
+    bool done = false;
+    bool saved = false; /** the main file, and so every segment, was written */
+};
+
 typedef unordered_set<Client *, ClientHash, ClientHash> HashTableClient;
+typedef unordered_map<unsigned int, ServiceProvider *> HashTableServiceProvider;
+typedef unordered_map<unsigned int, ContractedEmployee *> HashTableContractedEmployee;
 
 /**
  * @class Pitch
@@ -39,18 +113,205 @@ class Pitch {
     string clientsFile; /** file from which will be loaded and to which will be saved the clients information */
     string employeesFile; /** file from which will be loaded and to which will be saved the employees information */
     string liftsFile; /** file from which will be loaded and to which will be saved the lifts information */
+    string snapshotFile; /** binary snapshot of all the information, loaded instead of the text files when it is up to date */
+    string journalFile; /** mutations done after the snapshot was saved, snapshotFile followed by ".journal" */
+    Journal journal;
+    FileWriter textWriter; /** writes clientsFile, employeesFile and liftsFile, reusing its buffer from one to the next */
+    bool journaling = false; /** false while loading, so rebuilding the state does not record it again, and for good
+                              * if the journal could not be replayed */
+    uint64_t snapshotSequence = 0; /** last journal entry included in the last snapshot loaded or saved */
+    uint64_t snapshotGeneration = 0; /** number of the last snapshot save */
+    vector<uint64_t> segmentGenerations[SEGMENT_NUMKINDS]; /** generation of each segment in the snapshot, 0 if it is not there */
+    vector<RemovedMember> removedMembers; /** members taken out since the last save, which the next one leaves out */
+    uint64_t lastSaveBytes = 0; /** bytes written by the last snapshot save */
+    vector<SnapshotReader *> liftHistories; /** lift segments of the snapshot, by number, where lifts read their moves from when they need them */
+    thread snapshotThread; /** writes the snapshot saves, so the menus do not wait for them */
+    mutex snapshotMutex; /** held while snapshotJob or stopSnapshots are used */
+    condition_variable snapshotChanged; /** signalled when a save is handed to snapshotThread, finished or when it must stop */
+    SnapshotJob *snapshotJob = NULL; /** save being written by snapshotThread, or written but not finished yet; NULL if none */
+    bool stopSnapshots = false;
+    unsigned int snapshotInterval = SNAPSHOTINTERVAL; /** seconds between snapshot saves while there are changes, 0 to save only when the journal is too big */
+    chrono::steady_clock::time_point lastSnapshot; /** when the last snapshot save was prepared */
 
     HashTableClient clients; /** hash table with all clients organized by their NIFs */
 
     vector<Lift *> lifts; /** vector of pointers to the lifts owned by the Pitch's clients */
     vector<Lift *> ownedLifts; /** vector of pointer to lifts owned by Pitch */
+    vector<Lift *> liftsByCode; /** lifts indexed by code - FIRSTLIFTCODE, NULL (tombstone) for codes not in use */
 
     BST<MaintenanceRecord> maintenances; /** binary search tree of all maintenances done by Pitch */
+    BST<MaintenanceRecord> pendingMaintenances; /** binary search tree of the maintenances still not executed, so updateMaintenances only visits due work */
 
     vector<Employee *> employees; /** vector of pointers to the Pitch employees */
-    heapEmployeesSP serviceProviders; /** priority_queue of all Pitch service providers */
-    heapEmployeesCE contractedEmployees; /** priority_queue of all Pitch contracted employees */
+    HashTableServiceProvider serviceProvidersByNif; /** hash table with all service providers organized by their NIFs */
+    HashTableContractedEmployee contractedEmployeesByNif; /** hash table with all contracted employees organized by their NIFs */
+    heapEmployeesSP serviceProviders; /** indexed heap of all Pitch service providers, the one with fewer maintenances done on top */
+    SlotCalendar calendar; /** slots in which each service provider has work, so free ones are found for a whole crew at once */
+    heapEmployeesCE contractedEmployees; /** indexed heap of all Pitch contracted employees, the best evaluated on top */
+    heapEmployeesLoad contractedEmployeesByLoad; /** indexed heap of all Pitch contracted employees, the one with less clients associated on top */
+
+    /**
+     * Registers the lift given as parameter in liftsByCode, growing the table up to its code if needed
+     * @param toIndex pointer to the lift to be indexed
+     */
+    void indexLift(Lift *toIndex);
+
+    /**
+     * Appends a mutation that was just done to the journal, compacting it into a snapshot if it got too big
+     * @param entry the mutation
+     */
+    void record(JournalEntry &entry);
+
+    /**
+     * Redoes a mutation read from the journal
+     * @param entry the mutation
+     */
+    void applyJournalEntry(JournalEntry &entry);
+
+    /**
+     * Inserts the employee in the vector, the directory and the queues of his type
+     * @param toAdd pointer to the employee to be added
+     */
+    void registerEmployee(Employee *toAdd);
+
+    /**
+     * Removes the employee from the vector, the directory and the queues, once his work was handed to others
+     * @param toRm pointer to the employee to be removed
+     */
+    void forgetEmployee(Employee *toRm);
+
+    /**
+     * Associates the client to the contracted employee, keeping the queues in order
+     */
+    void associate(Client *c, ContractedEmployee *ce);
+
+    /**
+     * Creates a maintenance and puts it in the schedule of the service provider given as parameter
+     * @return the maintenance created
+     */
+    Maintenance *assignMaintenance(unsigned int code, ServiceProvider *sp, Date appoint, Time sched);
+
+    /**
+     * Executes right away a maintenance of the lift by the service provider given as parameter
+     */
+    void executeAutomaticMaintenance(Lift *lift, ServiceProvider *sp, Date today, Time time);
+
+    /**
+     * Takes a pending maintenance from the schedule of its service provider and puts it in the schedule of another one
+     */
+    void moveMaintenance(Maintenance *m, ServiceProvider *to);
+
+    /**
+     * Takes a pending maintenance out of the schedule of its service provider, if he is still there, and out of the
+     * maintenances trees, so it is never executed
+     */
+    void cancelMaintenance(Maintenance *m);
+
+    /**
+     * Fills byColumn with the service providers in serviceProviders, at the position of their column in calendar, and
+     * eligible with a bit set for each of those columns
+     */
+    void calendarColumns(vector<ServiceProvider *> &byColumn, vector<uint64_t> &eligible) const;
+
+    /**
+     * Records that a member was taken out, so the next save leaves it out of its segment
+     * @param segmentKey code of the lift, NIF of the client or employee, or Date::toKey() of the appointment of the
+     * maintenance
+     * @param key code of the lift, NIF of the client or employee, or id of the maintenance
+     */
+    void markRemoved(SnapshotSegmentKind kind, unsigned int segmentKey, uint32_t key);
+
+    /**
+     * @return the update of the segment of the given kind and key, see segmentOf, in a save, added to it the first time
+     * @param updates the updates already in the save, by kind and number
+     */
+    SegmentUpdate &updateOf(SnapshotJob &job, map<pair<unsigned int, unsigned int>, SegmentUpdate *> &updates,
+                            SnapshotSegmentKind kind, unsigned int key);
+
+    /**
+     * @return true if the maintenance, lift, client or employee is part of Pitch, and not one taken out of it or never
+     * added to it
+     */
+    bool holds(Maintenance *m) const;
+
+    bool holds(Lift *l) const;
+
+    bool holds(Client *c) const;
+
+    bool holds(Employee *e) const;
+
+    /**
+     * Leaves out of members the ones Pitch does not hold anymore, taken out after they changed
+     */
+    template<class T>
+    void keepHeld(vector<T *> &members) const;
+
+    /**
+     * Keeps the generation of each segment listed in the snapshot
+     */
+    void rememberSegments(const SnapshotSegment *segments, uint64_t n);
+
+    /**
+     * Body of snapshotThread: writes each save handed to it until it is told to stop, finishing the one it has first;
+     * in between, writes the journal entries that waited too long for a group
+     */
+    void writeSnapshots();
+
+    /**
+     * @return true if the journal is too big, or has entries and it is time for a save
+     */
+    bool snapshotDue() const;
+
+    /**
+     * @return true if snapshotThread is writing a save
+     */
+    bool snapshotInProgress();
+
+    /**
+     * Marks every member changed or removed until now as saved, once they are all in the snapshot just loaded
+     */
+    void markAllSaved();
+
+    /**
+     * Marks every member as changed, so the next save copies all of them again after one that failed
+     */
+    void markAllChanged();
+
+    /**
+     * Builds the maintenances saved in the maintenance segments of the snapshot, with the trees that hold them
+     * @param segments the maintenance segments, in the order of their numbers
+     * @param byId gets each maintenance at the position of its id
+     */
+    void loadSnapshotMaintenances(const deque<SnapshotReader> &segments, vector<Maintenance *> &byId);
+
+    /**
+     * Builds the lifts, clients and employees saved in a segment of the snapshot, which must stay open while the lifts
+     * in it read their moves from it
+     * @param byId maintenances of the snapshot, at the position of their ids
+     */
+    void loadSnapshotRecords(const SnapshotReader &snap, const vector<Maintenance *> &byId);
 
+    /**
+     * Makes the lifts of a lift segment just saved read their moves from it, closing the file it replaces
+     * @param reader the segment, opened by snapshotThread; NULL if it could not be, the lifts then keep their moves in
+     * memory
+     */
+    void attachLiftSegment(const SnapshotSegment &segment, SnapshotReader *reader);
+
+    /**
+     * Adds the lifts read from liftsFile, with their maintenance histories
+     */
+    void addLoadedLifts(ParsedLifts &parsed);
+
+    /**
+     * Adds the clients read from clientsFile, giving them their lifts, which must already be loaded
+     */
+    void addLoadedClients(ParsedClients &parsed);
+
+    /**
+     * Adds the employees read from employeesFile, associating them to their clients, which must already be loaded
+     */
+    void addLoadedEmployees(ParsedEmployees &parsed);
 
 public:
     /**
@@ -58,8 +319,20 @@ public:
      * @param clientsFile has default value "clients.txt"
      * @param employeesFile has default value "employees.txt"
      * @param liftsFile has default value "lifts.txt"
+     * @param snapshotFile has default value "pitch.snap"
+     */
+    Pitch(string clientsFile = "clients.txt", string employeesFile = "employees.txt", string liftsFile = "lifts.txt",
+          string snapshotFile = "pitch.snap");
+
+    /**
+     * Waits for the snapshot save being written, so every save started is on disk once Pitch is gone
+     */
+    ~Pitch();
+
+    /**
+     * Loads lifts, clients and employees from the text files, reading the three at the same time
      */
-    Pitch(string clientsFile = "clients.txt", string employeesFile = "employees.txt", string liftsFile = "lifts.txt");
+    void loadTextFiles();
 
     /**
      * Loads from clientsFile the information about clients
@@ -92,10 +365,57 @@ public:
     void saveLifts();
 
     /**
-     * Saves information concerning the lifts, clients and employees to the correspondent files
+     * @return true if one of the text files was modified after the given moment, as given by fileModificationTime
+     */
+    bool textFilesNewerThan(long long time) const;
+
+    /**
+     * Loads all the information from snapshotFile, if it exists and none of the text files was modified after it
+     * @return false if the snapshot was not loaded, in which case nothing was changed
+     */
+    bool loadSnapshot();
+
+    /**
+     * Starts saving all the information to snapshotFile, rewriting only the segments with members that changed since
+     * the last save, and then dropping from the journal the mutations in the save. Only the members that changed are
+     * visited and copied right away, so Pitch can be changed while snapshotThread writes them; snapshotThread copies
+     * the others from the files saved before. A save still being written is waited for first
+     */
+    void startSnapshot();
+
+    /**
+     * Waits for the save being written, if there is one, and makes the lifts read their moves from the new segments
+     * @return false if the save failed, in which case its segments are saved again the next time
+     */
+    bool waitForSnapshot();
+
+    /**
+     * @param seconds time between snapshot saves while there are changes, 0 to save only when the journal is too big
+     */
+    void setSnapshotInterval(unsigned int seconds);
+
+    /**
+     * @return bytes written by the last snapshot save
+     */
+    uint64_t getLastSaveBytes() const;
+
+    /**
+     * Saves a snapshot and empties the journal, whose mutations are all in it, waiting until it is written
+     * @return false if the snapshot could not be written, in which case the journal is kept
+     */
+    bool checkpoint();
+
+    /**
+     * Makes the mutations done so far durable by writing what is left of the journal, compacting it in the background
+     * if it got too big or it is time for a save
      */
     void saveData();
 
+    /**
+     * Exports the information concerning the lifts, clients and employees to the correspondent text files
+     */
+    void exportData();
+
     /**
      * Searches for a certain client given a NIF
      * @param searchedNIF NIF of the client to be searched
@@ -104,6 +424,13 @@ public:
      */
     Client *searchClient(unsigned int searchedNIF);
 
+    /**
+     * Looks up a client by NIF in the clients hash table, without throwing
+     * @param searchedNIF NIF of the client to be searched
+     * @return pointer to the client searched, NULL if there is no client with that NIF
+     */
+    Client *findClient(unsigned int searchedNIF) const;
+
     /**
       * Searches for a certain employee given a NIF
       * @param searchedNIF NIF of the employee to be searched
@@ -112,6 +439,25 @@ public:
       */
     Employee *searchEmployee(unsigned int searchedNIF);
 
+    /**
+     * Looks up an employee by NIF in the employees directory, without throwing
+     * @param searchedNIF NIF of the employee to be searched
+     * @return pointer to the employee searched, NULL if there is no employee with that NIF
+     */
+    Employee *findEmployee(unsigned int searchedNIF) const;
+
+    /**
+     * @param searchedNIF NIF of the service provider to be searched
+     * @return pointer to the service provider searched, NULL if there is no service provider with that NIF
+     */
+    ServiceProvider *findServiceProvider(unsigned int searchedNIF) const;
+
+    /**
+     * @param searchedNIF NIF of the contracted employee to be searched
+     * @return pointer to the contracted employee searched, NULL if there is no contracted employee with that NIF
+     */
+    ContractedEmployee *findContractedEmployee(unsigned int searchedNIF) const;
+
     /**
      * Searches for the employee associated to the client whose NIF is clientNIF
      * @param clientNIF NIF of the client whose associated employee is to be obtained
@@ -129,6 +475,13 @@ public:
      */
     Lift *searchLift(unsigned int searchedCode);
 
+    /**
+     * Looks up a lift by code in liftsByCode, without throwing
+     * @param searchedCode code of the lift to be searched
+     * @return pointer to the lift searched, NULL if there is no lift with that code or if it was removed
+     */
+    Lift *findLift(unsigned int searchedCode) const;
+
     /**
      * Allows to know whether or not an employee exists
      * @param nif NIF of the searched employee
@@ -143,6 +496,10 @@ public:
      */
     void addClient(Client *toAdd);
 
+    /**
+     * Adds a service provider to serviceProviders or, if he is already there, restores his position after his number of maintenances or evaluation changed
+     * @param spt service provider to be added or repositioned
+     */
     void addServiceProvider(ServiceProviderType spt);
 
     void addContractedEmployee(ContractedEmployee *e);
@@ -163,6 +520,17 @@ public:
      */
     void addLift(Lift *toAdd);
 
+    /**
+     * Removes a lift from vector lifts and from its owner, leaving a tombstone in liftsByCode so codes are never reused
+     * @param code code of the lift to be removed
+     * @throws LiftDoesNotExist
+     */
+    void removeLift(unsigned int code);
+
+    /**
+     * Adds a maintenance to the maintenances tree and, if it is still not executed, to pendingMaintenances as well
+     * @param maintenance pointer to the maintenance to be added
+     */
     void addMaintenance(Maintenance *maintenance);
 
     /**
@@ -187,12 +555,37 @@ public:
 
 
     /**
-     * Schedules the asked maintenance to the next available sp
+     * Schedules the asked maintenance to the next available sp: of the service providers with no appointment
+     * overlapping it, the one nearest the top of serviceProviders
+     * @return false if every service provider is busy at that moment
      */
     bool scheduleMaintenance(Lift *lift, Time schedule, Date today);
 
+    /**
+     * Schedules many maintenances in one pass, in the order they are given. Each one goes to the earliest moment of its
+     * window, trying one every half hour, at which some service provider is free, and to the free service provider
+     * with the fewest maintenances, counting those done, those already scheduled and those given in this batch (the
+     * best evaluated one on a tie), as reassignMaintenances does
+     * @param requests maintenances asked
+     * @return positions in requests of the maintenances that could not be scheduled, because no service provider was
+     * free at any moment of their window
+     */
+    vector<unsigned int> scheduleBatch(const vector<MaintenanceRequest> &requests);
+
+    /**
+     * Marks as executed every pending maintenance scheduled before the given moment, visiting only those
+     * @param actualTime current time
+     * @param actualDate current date
+     */
     void updateMaintenances(Time actualTime, Date actualDate);
 
+    /**
+     * @param from first date of the range
+     * @param to last date of the range
+     * @return maintenances, executed or not, scheduled from the date from to the date to (both inclusive), sorted by date and time
+     */
+    vector<Maintenance *> getMaintenancesBetween(Date from, Date to);
+
     /**
      * @return pointer to the most reviewed employee, either a service provider or a contracted employee
      */
@@ -214,10 +607,17 @@ public:
     Employee *getWorstEvaluatedEmployee();
 
     /**
-     * @return pointer to the employee with less clients associated, either a service provider or a contracted employee
+     * @return pointer to the contracted employee with less clients associated, NULL if there are no contracted employees
      */
     Employee *getEmployeeWithLessClientsAssociated();
 
+    /**
+     * Associates each of the clients of the contracted employee given as parameter to the contracted employee that has currently less clients associated
+     * the employee given as parameter is taken out of contractedEmployeesByLoad so none of his clients goes back to him
+     * @param from pointer to the contracted employee whose clients are to be redistributed
+     */
+    void redistributeClients(ContractedEmployee *from);
+
     /**
      * @return pointer to the client who has purchased his first lift at the longest time ago
      */
@@ -254,16 +654,33 @@ public:
     void temporarilyRemoveEmployee(unsigned int nif);
 
     /**
-     *
+     * Removes an employee; the clients of a contracted employee are redistributed, and the maintenances a service
+     * provider had scheduled are reassigned to the others (see reassignMaintenances)
      * @param nif NIF of the employee to be removed
+     * @return maintenances of the service provider removed that no other one was free to take; they are cancelled
+     */
+    vector<Maintenance *> removeEmployee(unsigned int nif);
+
+    /**
+     * Gives the pending maintenances as parameter to the service providers in serviceProviders free at their time.
+     * They are taken in order of time, in groups of maintenances that all overlap one another: a service provider
+     * takes at most one of a group, and each group is placed at once, as a maximum bipartite matching between its
+     * maintenances and the service providers free for them, the earlier maintenances and the service providers with
+     * fewer maintenances being preferred. A group is placed before the next one is looked at, so with maintenances
+     * overlapping one another in a chain (9:00, 10:00, 11:00) a choice is not undone for a later group; when no two of
+     * them overlap, as the schedule of a single service provider, every maintenance that can be placed is.
+     * Finishes in O(k e) for k maintenances and e pairs of a maintenance and a service provider free for it
+     * @param toReassign maintenances to be given to other service providers
+     * @return the maintenances that could not be placed, left where they were
      */
-    void removeEmployee(unsigned int nif);
+    vector<Maintenance *> reassignMaintenances(const vector<Maintenance *> &toReassign);
 
     /**
      * Removes an employee from the vector employees
      * if the client to be removed is of type entrepreneur, meaning he has a contracted employee associated, the first is also removed from the last's vector
      * if the client to be removed has any lifts on his name, those lifts are transfered to Pitch Company's name
      * @param nif
+     * @throws ClientDoesNotExist
      */
     void removeClient(unsigned int nif);
 
@@ -0,0 +1,164 @@
+#include "SlotCalendar.h"
+
+using namespace std;
+
+/** a divided by b, rounded down also for moments before 1/1/1970 */
+static long long floorDiv(long long a, long long b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/** first slot a maintenance starting at the given moment has a moment in */
+static long long firstTouched(Timestamp start) {
+    return floorDiv(start, SLOTSECONDS);
+}
+
+/** last slot a maintenance starting at the given moment has a moment in, its end included */
+static long long lastTouched(Timestamp start) {
+    return floorDiv(start + MAINTDURATION_SECONDS, SLOTSECONDS);
+}
+
+/** first slot a maintenance starting at the given moment lasts all through */
+static long long firstCovered(Timestamp start) {
+    return floorDiv(start + SLOTSECONDS - 1, SLOTSECONDS);
+}
+
+/** last slot a maintenance starting at the given moment lasts all through */
+static long long lastCovered(Timestamp start) {
+    return floorDiv(start + MAINTDURATION_SECONDS + 1, SLOTSECONDS) - 1;
+}
+
+
+SlotCalendar::SlotCalendar() : columns(0) {}
+
+unsigned int SlotCalendar::addColumn() {
+    unsigned int column;
+    if (!freeColumns.empty()) {
+        column = freeColumns.back();
+        freeColumns.pop_back();
+    } else {
+        column = columns++;
+        if (used.size() < (columns + 63) / 64)
+            used.push_back(0);
+    }
+    used[column / 64] |= (uint64_t) 1 << (column % 64);
+    return column;
+}
+
+void SlotCalendar::removeColumn(unsigned int column, const Agenda &agenda) {
+    for (Agenda::const_iterator it = agenda.begin(); it != agenda.end(); it++)
+        clear(column, *it, NULL);
+    used[column / 64] &= ~((uint64_t) 1 << (column % 64));
+    freeColumns.push_back(column);
+}
+
+void SlotCalendar::book(unsigned int column, const Maintenance *m) {
+    uint64_t bit = (uint64_t) 1 << (column % 64);
+    Timestamp start = m->getStart();
+    long long lastDay = floorDiv(lastTouched(start), SLOTSPERDAY);
+    for (long long day = floorDiv(firstTouched(start), SLOTSPERDAY); day <= lastDay; day++)
+        days[day].bookings++; //a new day starts with no words and no bookings
+    for (long long slot = firstTouched(start); slot <= lastTouched(start); slot++) {
+        SlotWords *w = words(slot, column, true);
+        unsigned int inDay = slot - floorDiv(slot, SLOTSPERDAY) * SLOTSPERDAY;
+        w->touched[inDay] |= bit;
+        if (firstCovered(start) <= slot && slot <= lastCovered(start))
+            w->covered[inDay] |= bit;
+    }
+}
+
+void SlotCalendar::release(unsigned int column, const Maintenance *m, const Agenda &agenda) {
+    clear(column, m, &agenda);
+}
+
+void SlotCalendar::clear(unsigned int column, const Maintenance *m, const Agenda *agenda) {
+    uint64_t bit = (uint64_t) 1 << (column % 64);
+    Timestamp start = m->getStart();
+    for (long long slot = firstTouched(start); slot <= lastTouched(start); slot++) {
+        SlotWords *w = words(slot, column, false);
+        if (w == NULL)
+            continue;
+        unsigned int inDay = slot - floorDiv(slot, SLOTSPERDAY) * SLOTSPERDAY;
+        Timestamp slotStart = slot * SLOTSECONDS, slotEnd = slotStart + SLOTSECONDS - 1;
+        //a mark stays if another appointment left in the agenda makes it too
+        Agenda::const_iterator it;
+        if (agenda == NULL || (it = agenda->from(slotStart - MAINTDURATION_SECONDS)) == agenda->end() ||
+            (*it)->getStart() > slotEnd)
+            w->touched[inDay] &= ~bit;
+        if (agenda == NULL || (it = agenda->from(slotEnd - MAINTDURATION_SECONDS)) == agenda->end() ||
+            (*it)->getStart() > slotStart)
+            w->covered[inDay] &= ~bit;
+    }
+    long long lastDay = floorDiv(lastTouched(start), SLOTSPERDAY);
+    for (long long day = floorDiv(firstTouched(start), SLOTSPERDAY); day <= lastDay; day++) {
+        unordered_map<long long, Day>::iterator it = days.find(day);
+        if (it != days.end() && --it->second.bookings == 0) //no maintenance left with a mark in it
+            days.erase(it);
+    }
+}
+
+void SlotCalendar::busyAt(Timestamp start, vector<uint64_t> &maybeBusy, vector<uint64_t> &surelyBusy) const {
+    maybeBusy.assign(used.size(), 0);
+    surelyBusy.assign(used.size(), 0);
+    for (long long slot = firstTouched(start); slot <= lastTouched(start); slot++) {
+        unordered_map<long long, Day>::const_iterator day = days.find(floorDiv(slot, SLOTSPERDAY));
+        if (day == days.end())
+            continue;
+        unsigned int inDay = slot - day->first * SLOTSPERDAY;
+        bool covered = firstCovered(start) <= slot && slot <= lastCovered(start);
+        for (unsigned int group = 0; group < day->second.groups.size(); group++) {
+            const SlotWords &w = day->second.groups[group];
+            maybeBusy[group] |= w.touched[inDay];
+            //an appointment lasting all through a slot the maintenance has a moment in overlaps it, and the other way round
+            surelyBusy[group] |= w.covered[inDay];
+            if (covered)
+                surelyBusy[group] |= w.touched[inDay];
+        }
+    }
+}
+
+bool SlotCalendar::isBusyAt(unsigned int column, Timestamp start) const {
+    uint64_t bit = (uint64_t) 1 << (column % 64);
+    for (long long slot = firstTouched(start); slot <= lastTouched(start); slot++) {
+        const SlotWords *w = words(slot, column);
+        if (w != NULL && (w->touched[slot - floorDiv(slot, SLOTSPERDAY) * SLOTSPERDAY] & bit) != 0)
+            return true;
+    }
+    return false;
+}
+
+bool SlotCalendar::isSurelyBusyAt(unsigned int column, Timestamp start) const {
+    uint64_t bit = (uint64_t) 1 << (column % 64);
+    for (long long slot = firstTouched(start); slot <= lastTouched(start); slot++) {
+        const SlotWords *w = words(slot, column);
+        if (w == NULL)
+            continue;
+        unsigned int inDay = slot - floorDiv(slot, SLOTSPERDAY) * SLOTSPERDAY;
+        uint64_t marks = w->covered[inDay];
+        if (firstCovered(start) <= slot && slot <= lastCovered(start))
+            marks |= w->touched[inDay];
+        if ((marks & bit) != 0)
+            return true;
+    }
+    return false;
+}
+
+SlotCalendar::SlotWords *SlotCalendar::words(long long slot, unsigned int column, bool create) {
+    unordered_map<long long, Day>::iterator it = days.find(floorDiv(slot, SLOTSPERDAY));
+    if (it == days.end())
+        return NULL;
+    vector<SlotWords> &groups = it->second.groups;
+    if (groups.size() <= column / 64) {
+        if (!create)
+            return NULL;
+        SlotWords empty = {};
+        groups.resize(column / 64 + 1, empty);
+    }
+    return &groups[column / 64];
+}
+
+const SlotCalendar::SlotWords *SlotCalendar::words(long long slot, unsigned int column) const {
+    unordered_map<long long, Day>::const_iterator it = days.find(floorDiv(slot, SLOTSPERDAY));
+    if (it == days.end() || it->second.groups.size() <= column / 64)
+        return NULL;
+    return &it->second.groups[column / 64];
+}
@@ -0,0 +1,94 @@
+#ifndef SLOTCALENDAR_H
+#define SLOTCALENDAR_H
+
+#include "Maintenance.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+#define SLOTSECONDS 1800 /** length of a slot of the calendar, a third of MAINTDURATION */
+#define SLOTSPERDAY (SECONDSPERDAY / SLOTSECONDS)
+
+/**
+ * @class SlotCalendar
+ * Which service providers have work in each half hour of each day, one bit per provider (his column), kept in words
+ * of 64 providers so a whole crew is checked with a few word-wide operations.
+ * A maintenance marks as touched every slot it has a moment in, and as covered the slots it lasts all through. A
+ * provider with no touched slot among those of a maintenance is certainly free for it, and one with a covered slot
+ * among those the maintenance lasts all through is certainly busy; only for the others, whose appointments and the
+ * maintenance share the edge of a slot, his Agenda has to tell.
+ * A day is only kept while some maintenance booked in it is still in an agenda, so the days that went by, their
+ * maintenances executed, take no memory.
+ */
+class SlotCalendar {
+public:
+    SlotCalendar();
+
+    /**
+     * @return a column for a new provider, with no slot marked
+     */
+    unsigned int addColumn();
+
+    /**
+     * Clears the slots of every appointment in agenda from the column and frees it for another provider
+     */
+    void removeColumn(unsigned int column, const Agenda &agenda);
+
+    /**
+     * Marks in the column the slots a maintenance touches and covers
+     */
+    void book(unsigned int column, const Maintenance *m);
+
+    /**
+     * Clears from the column the marks of a maintenance that no appointment left in agenda also makes
+     * @param agenda appointments of the provider, already without m
+     */
+    void release(unsigned int column, const Maintenance *m, const Agenda &agenda);
+
+    /**
+     * Fills maybeBusy and surelyBusy with one bit per column for a maintenance starting at the given moment: set in
+     * maybeBusy for the providers that may have work then (the others are certainly free), and in surelyBusy for those
+     * that certainly have
+     */
+    void busyAt(Timestamp start, vector<uint64_t> &maybeBusy, vector<uint64_t> &surelyBusy) const;
+
+    /**
+     * @return false if the provider of the column is certainly free for a maintenance starting at the given moment
+     */
+    bool isBusyAt(unsigned int column, Timestamp start) const;
+
+    /**
+     * @return true if the provider of the column is certainly busy for a maintenance starting at the given moment
+     */
+    bool isSurelyBusyAt(unsigned int column, Timestamp start) const;
+
+private:
+    struct SlotWords {
+        uint64_t touched[SLOTSPERDAY];
+        uint64_t covered[SLOTSPERDAY];
+    };
+
+    struct Day {
+        vector<SlotWords> groups; /** words of the slots of the day, for each group of 64 columns */
+        unsigned int bookings; /** maintenances booked with a slot in the day; the day is dropped when none is left */
+    };
+
+    unordered_map<long long, Day> days; /** day (since 1/1/1970) -> its slots, only while it has maintenances booked */
+    vector<uint64_t> used; /** one bit per column, set while a provider has it */
+    vector<unsigned int> freeColumns; /** columns given back, reused before new ones */
+    unsigned int columns;
+
+    /**
+     * @return words of the group of 64 columns the given one is in, on the day of the given slot (since 1/1/1970);
+     * NULL if the day has no maintenances booked, or if nothing was marked in the group and create is false
+     */
+    SlotWords *words(long long slot, unsigned int column, bool create);
+
+    const SlotWords *words(long long slot, unsigned int column) const;
+
+    void clear(unsigned int column, const Maintenance *m, const Agenda *agenda);
+};
+
+#endif
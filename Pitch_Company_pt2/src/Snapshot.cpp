@@ -0,0 +1,461 @@
+#include "Snapshot.h"
+#include "Utils.h"
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const size_t recordSize[SNAPSHOT_NUMSECTIONS] = {
+        sizeof(SnapshotLift), sizeof(char), sizeof(SnapshotMaintenance), sizeof(SnapshotClient),
+        sizeof(SnapshotEmployee), sizeof(uint32_t), sizeof(char), sizeof(SnapshotSegment)
+};
+
+static uint64_t alignTo8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+/**
+ * Maps signed numbers to unsigned ones so the ones near 0, of both signs, are small
+ */
+static uint64_t zigzag(int64_t x) {
+    return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63);
+}
+
+static int64_t unzigzag(uint64_t x) {
+    return (int64_t) (x >> 1) ^ -(int64_t) (x & 1);
+}
+
+/**
+ * Appends x in 7 bit groups, the lowest first, the high bit of each byte telling whether another one follows
+ */
+static void putVarint(string &out, uint64_t x) {
+    while (x >= 0x80) {
+        out += (char) (x | 0x80);
+        x >>= 7;
+    }
+    out += (char) x;
+}
+
+/**
+ * @return false if the number does not end before last
+ */
+static bool getVarint(const char *&first, const char *last, uint64_t &x) {
+    x = 0;
+    for (unsigned int shift = 0; first != last && shift < 64; shift += 7) {
+        unsigned char byte = (unsigned char) *first++;
+        x |= (uint64_t) (byte & 0x7f) << shift;
+        if (byte < 0x80)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Date and time of a move as one number that grows with them; times are always below 2^17 seconds
+ */
+static uint64_t moveStamp(uint32_t date, uint32_t tInitial) {
+    return ((uint64_t) date << 17) | tInitial;
+}
+
+
+MappedFile::MappedFile() : base(NULL), length(0) {
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#else
+    fd = -1;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string &path) {
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        close();
+        return false;
+    }
+    base = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (base == NULL) {
+        close();
+        return false;
+    }
+    length = (size_t) fileSize.QuadPart;
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close();
+        return false;
+    }
+    void *p = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        close();
+        return false;
+    }
+    base = (const char *) p;
+    length = (size_t) info.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (base != NULL)
+        UnmapViewOfFile(base);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (base != NULL)
+        munmap((void *) base, length);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+    base = NULL;
+    length = 0;
+}
+
+const char *MappedFile::data() const {
+    return base;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+
+SnapshotWriter::SnapshotWriter() : journalSequence(0), generation(0) {}
+
+void SnapshotWriter::addMoves(const vector<SnapshotMove> &moves, SnapshotLift &lift) {
+    string stamps, froms, tos;
+    uint64_t previousStamp = 0;
+    int64_t previousTo = 0;
+    for (vector<SnapshotMove>::const_iterator it = moves.begin(); it != moves.end(); it++) {
+        uint64_t stamp = moveStamp(it->date, it->tInitial);
+        putVarint(stamps, zigzag((int64_t) (stamp - previousStamp)));
+        putVarint(froms, zigzag(it->from - previousTo));
+        putVarint(tos, zigzag((int64_t) it->to - it->from));
+        previousStamp = stamp;
+        previousTo = it->to;
+    }
+    lift.numMoves = moves.size();
+    lift.movesOffset = moveColumns.size();
+    putVarint(moveColumns, stamps.size()); //where each column starts, so they can be read side by side
+    putVarint(moveColumns, froms.size());
+    moveColumns += stamps;
+    moveColumns += froms;
+    moveColumns += tos;
+    lift.movesLength = moveColumns.size() - lift.movesOffset;
+}
+
+void SnapshotWriter::copyMoves(const SnapshotReader &from, const SnapshotLift &saved, SnapshotLift &lift) {
+    lift.numMoves = saved.numMoves;
+    lift.movesOffset = moveColumns.size();
+    lift.movesLength = saved.movesLength;
+    moveColumns.append(from.moveColumns() + saved.movesOffset, saved.movesLength);
+}
+
+SnapshotString SnapshotWriter::addString(const string &s) {
+    SnapshotString ref;
+    ref.offset = (uint32_t) strings.size();
+    ref.length = (uint32_t) s.size();
+    strings += s;
+    return ref;
+}
+
+/**
+ * Fills the header of the snapshot, placing each section after the previous one
+ * @return size of the file
+ */
+uint64_t SnapshotWriter::layout(SnapshotHeader &header) const {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOTMAGIC, sizeof(header.magic));
+    header.version = SNAPSHOTVERSION;
+    header.byteOrder = SNAPSHOTBYTEORDER;
+    header.journalSequence = journalSequence;
+    header.generation = generation;
+
+    header.count[SNAPSHOT_LIFTS] = lifts.size();
+    header.count[SNAPSHOT_MOVECOLUMNS] = moveColumns.size();
+    header.count[SNAPSHOT_MAINTENANCES] = maintenances.size();
+    header.count[SNAPSHOT_CLIENTS] = clients.size();
+    header.count[SNAPSHOT_EMPLOYEES] = employees.size();
+    header.count[SNAPSHOT_REFS] = refs.size();
+    header.count[SNAPSHOT_STRINGS] = strings.size();
+    header.count[SNAPSHOT_SEGMENTS] = segments.size();
+
+    uint64_t offset = alignTo8(sizeof(header));
+    for (unsigned int s = 0; s < SNAPSHOT_NUMSECTIONS; s++) {
+        header.offset[s] = offset;
+        offset = alignTo8(offset + header.count[s] * recordSize[s]);
+    }
+    unsigned int last = SNAPSHOT_NUMSECTIONS - 1;
+    return header.offset[last] + header.count[last] * recordSize[last];
+}
+
+uint64_t SnapshotWriter::size() const {
+    SnapshotHeader header;
+    return layout(header);
+}
+
+bool SnapshotWriter::write(const string &path) const {
+    SnapshotHeader header;
+    layout(header);
+    const char *data[SNAPSHOT_NUMSECTIONS] = {
+            (const char *) lifts.data(), moveColumns.data(), (const char *) maintenances.data(),
+            (const char *) clients.data(), (const char *) employees.data(), (const char *) refs.data(),
+            strings.data(), (const char *) segments.data()
+    };
+
+    //written beside the old file and on the disk before it replaces it, so a crash leaves one of the two whole
+    string tmpPath = path + ".tmp";
+    FILE *op = fopen(tmpPath.c_str(), "wb");
+    if (op == NULL)
+        return false;
+    static const char padding[8] = {0};
+    bool written = fwrite(&header, sizeof(header), 1, op) == 1;
+    uint64_t offset = sizeof(header);
+    for (unsigned int s = 0; written && s < SNAPSHOT_NUMSECTIONS; s++) {
+        size_t length = header.count[s] * recordSize[s];
+        written = fwrite(padding, 1, header.offset[s] - offset, op) == header.offset[s] - offset &&
+                  fwrite(data[s], 1, length, op) == length;
+        offset = header.offset[s] + length;
+    }
+    written = syncFile(op) && written;
+    written = fclose(op) == 0 && written;
+    if (!written || !replaceFile(tmpPath, path)) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+SnapshotMoveCursor::SnapshotMoveCursor(const char *data, uint32_t length, uint32_t count)
+        : stamps(data), froms(data), tos(data), end(data + length), left(count), stamp(0), to(0) {
+    uint64_t stampsLength, fromsLength;
+    if (!getVarint(stamps, end, stampsLength) || !getVarint(stamps, end, fromsLength) ||
+        stampsLength > (uint64_t) (end - stamps) || fromsLength > (uint64_t) (end - stamps) - stampsLength) {
+        left = 0;
+        return;
+    }
+    froms = stamps + stampsLength;
+    tos = froms + fromsLength;
+}
+
+bool SnapshotMoveCursor::next(SnapshotMove &move) {
+    if (left == 0)
+        return false;
+    uint64_t stampDelta, fromDelta, toDelta;
+    if (!getVarint(stamps, froms, stampDelta) || !getVarint(froms, tos, fromDelta) || !getVarint(tos, end, toDelta)) {
+        left = 0;
+        return false;
+    }
+    stamp += (uint64_t) unzigzag(stampDelta);
+    int64_t from = to + unzigzag(fromDelta);
+    to = from + unzigzag(toDelta);
+    move.date = (uint32_t) (stamp >> 17);
+    move.tInitial = (uint32_t) (stamp & 0x1ffff);
+    move.from = (int32_t) from;
+    move.to = (int32_t) to;
+    left--;
+    return true;
+}
+
+
+SnapshotReader::SnapshotReader() : header(NULL) {}
+
+bool SnapshotReader::open(const string &path) {
+    header = NULL;
+    if (!file.open(path))
+        return false;
+    if (file.size() < sizeof(SnapshotHeader)) {
+        file.close();
+        return false;
+    }
+    header = (const SnapshotHeader *) file.data();
+    if (memcmp(header->magic, SNAPSHOTMAGIC, sizeof(header->magic)) != 0 || header->version != SNAPSHOTVERSION ||
+        header->byteOrder != SNAPSHOTBYTEORDER || !validate()) {
+        header = NULL;
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+uint64_t SnapshotReader::count(SnapshotSection section) const {
+    return header != NULL ? header->count[section] : 0;
+}
+
+uint64_t SnapshotReader::getJournalSequence() const {
+    return header->journalSequence;
+}
+
+uint64_t SnapshotReader::getGeneration() const {
+    return header->generation;
+}
+
+const char *SnapshotReader::section(SnapshotSection s) const {
+    return file.data() + header->offset[s];
+}
+
+const SnapshotLift *SnapshotReader::lifts() const {
+    return (const SnapshotLift *) section(SNAPSHOT_LIFTS);
+}
+
+SnapshotMoveCursor SnapshotReader::moves(const SnapshotLift &lift) const {
+    return SnapshotMoveCursor(section(SNAPSHOT_MOVECOLUMNS) + lift.movesOffset, lift.movesLength, lift.numMoves);
+}
+
+const char *SnapshotReader::moveColumns() const {
+    return section(SNAPSHOT_MOVECOLUMNS);
+}
+
+const SnapshotMaintenance *SnapshotReader::maintenances() const {
+    return (const SnapshotMaintenance *) section(SNAPSHOT_MAINTENANCES);
+}
+
+const SnapshotClient *SnapshotReader::clients() const {
+    return (const SnapshotClient *) section(SNAPSHOT_CLIENTS);
+}
+
+const SnapshotEmployee *SnapshotReader::employees() const {
+    return (const SnapshotEmployee *) section(SNAPSHOT_EMPLOYEES);
+}
+
+const uint32_t *SnapshotReader::refs() const {
+    return (const uint32_t *) section(SNAPSHOT_REFS);
+}
+
+const SnapshotSegment *SnapshotReader::segments() const {
+    return (const SnapshotSegment *) section(SNAPSHOT_SEGMENTS);
+}
+
+string SnapshotReader::str(const SnapshotString &s) const {
+    return string(section(SNAPSHOT_STRINGS) + s.offset, s.length);
+}
+
+/**
+ * @return true if [first, first + n) fits in a section with total elements
+ */
+static bool inRange(uint64_t first, uint64_t n, uint64_t total) {
+    return first <= total && n <= total - first;
+}
+
+bool SnapshotReader::validate() const {
+    for (unsigned int s = 0; s < SNAPSHOT_NUMSECTIONS; s++) {
+        if (header->offset[s] % 8 != 0 || header->offset[s] < sizeof(SnapshotHeader) ||
+            !inRange(header->offset[s], header->count[s] * recordSize[s], file.size()) ||
+            header->count[s] > file.size())
+            return false;
+    }
+    uint64_t numStrings = count(SNAPSHOT_STRINGS);
+    for (uint64_t i = 0; i < count(SNAPSHOT_LIFTS); i++) {
+        const SnapshotLift &l = lifts()[i];
+        if (!inRange(l.movesOffset, l.movesLength, count(SNAPSHOT_MOVECOLUMNS)) ||
+            !inRange(l.firstMaintenance, l.numMaintenances, count(SNAPSHOT_REFS)) ||
+            !inRange(l.buildingName.offset, l.buildingName.length, numStrings) ||
+            !inRange(l.address.offset, l.address.length, numStrings))
+            return false; //the columns themselves are only decoded, and checked, when Lift::loadMoves reads them
+    }
+    for (uint64_t i = 0; i < count(SNAPSHOT_CLIENTS); i++) {
+        const SnapshotClient &c = clients()[i];
+        if (!inRange(c.firstLiftRef, c.numLifts, count(SNAPSHOT_REFS)) ||
+            !inRange(c.name.offset, c.name.length, numStrings))
+            return false;
+    }
+    for (uint64_t i = 0; i < count(SNAPSHOT_EMPLOYEES); i++) {
+        const SnapshotEmployee &e = employees()[i];
+        if (!inRange(e.firstRef, e.numRefs, count(SNAPSHOT_REFS)) || (e.kind != '+' && e.kind != 'x') ||
+            !inRange(e.name.offset, e.name.length, numStrings))
+            return false;
+    }
+    for (uint64_t i = 1; i < count(SNAPSHOT_MAINTENANCES); i++) { //in order, so they can be put in a tree as they are
+        const SnapshotMaintenance &a = maintenances()[i - 1], &b = maintenances()[i];
+        Timestamp aStart = toTimestamp(Date::fromKey(a.appointment), Time::fromSeconds(a.schedule));
+        Timestamp bStart = toTimestamp(Date::fromKey(b.appointment), Time::fromSeconds(b.schedule));
+        if (make_tuple(aStart, a.liftCode, a.spNif) >= make_tuple(bStart, b.liftCode, b.spNif))
+            return false;
+    }
+    for (uint64_t i = 0; i < count(SNAPSHOT_SEGMENTS); i++) {
+        if (segments()[i].kind >= SEGMENT_NUMKINDS)
+            return false;
+    }
+    return true;
+}
+
+
+long long fileModificationTime(const string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return -1;
+#ifdef __linux__
+    return (long long) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#else
+    return (long long) info.st_mtime;
+#endif
+}
+
+bool syncFile(FILE *f) {
+    if (fflush(f) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+bool replaceFile(const string &from, const string &to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(from.c_str(), to.c_str()) != 0)
+        return false;
+    //the new name is only on the disk once the directory that has it is
+    size_t slash = to.find_last_of('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : to.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+#endif
+}
+
+string segmentPath(const string &snapshotPath, const SnapshotSegment &segment) {
+    static const char *kindName[SEGMENT_NUMKINDS] = {"maintenances", "lifts", "clients", "employees"};
+    return snapshotPath + "." + kindName[segment.kind] + "-" + to_string(segment.number) + "." +
+           to_string(segment.generation);
+}
@@ -0,0 +1,333 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+#define SNAPSHOTMAGIC "PITCHSNP"
+#define SNAPSHOTVERSION 6
+#define SNAPSHOTBYTEORDER 0x01020304u
+#define LIFTSPERSEGMENT 4096 /** consecutive lift codes saved in the same segment */
+#define CLIENTSEGMENTS 16 /** clients are spread over this many segments by NIF */
+#define EMPLOYEESEGMENTS 4 /** employees are spread over this many segments by NIF */
+#define MAINTENANCEFIRSTYEAR 2000 /** maintenances get a segment per month from January of this year, earlier ones the first */
+
+/*
+ * Binary snapshot of the whole state of Pitch. The file is a header followed by one array of fixed size records per
+ * section; records refer to each other by index into those arrays (or by lift code / NIF), never by pointer, so the
+ * file can be used right where it is mapped in memory. Dates are stored as Date::toKey() and times as
+ * Time::toSeconds().
+ *
+ * The state is split in segments, each one a file in this same format holding a group of lifts, clients, employees
+ * or maintenances, so a save only rewrites the segments that changed. The main file only lists the segments in use.
+ * Every maintenance is saved once, in the segment of the month of its appointment, sorted by date, time, lift code and
+ * NIF of the service provider, so the segments one after the other have all of them in order; lifts and service
+ * providers refer to their maintenances by id.
+ *
+ * Moves are not stored as records but in columns, see SnapshotWriter::addMoves.
+ */
+
+/** text stored in the strings section */
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SnapshotLift {
+    uint32_t code;
+    uint32_t clientNif;
+    uint32_t capacity;
+    uint32_t nFloors;
+    int32_t regularTime;
+    int32_t currentFloor;
+    int32_t higherFloor;
+    int32_t lowerFloor;
+    uint32_t install;
+    uint32_t numMoves;
+    uint32_t movesOffset; /** offset of the lift's moves in the move columns section */
+    uint32_t movesLength; /** bytes taken by the lift's moves in the move columns section */
+    uint32_t numMaintenances;
+    uint32_t firstMaintenance; /** index in the references section of the ids of the lift's maintenance history */
+    SnapshotString buildingName;
+    SnapshotString address;
+};
+
+/** a move as written to and read from the move columns; floorCount and tFinal follow from it and the lift */
+struct SnapshotMove {
+    uint32_t date;
+    int32_t from;
+    int32_t to;
+    uint32_t tInitial;
+};
+
+struct SnapshotMaintenance {
+    uint32_t id;
+    uint32_t liftCode;
+    uint32_t spNif;
+    uint32_t appointment;
+    uint32_t schedule;
+    uint32_t finished;
+};
+
+struct SnapshotClient {
+    uint32_t nif;
+    uint32_t entrepreneur; /** 1 for entrepreneurs, 0 for particular clients */
+    uint32_t employeeNif;
+    uint32_t firstLift; /** date of the first lift purchased */
+    uint32_t numLifts;
+    uint32_t firstLiftRef; /** index in the references section of the codes of the client's lifts */
+    SnapshotString name;
+};
+
+struct SnapshotEmployee {
+    uint32_t nif;
+    uint32_t age;
+    uint32_t evaluation;
+    uint32_t numReviews;
+    uint32_t kind; /** '+' for service providers, 'x' for contracted employees, as in the employees file */
+    uint32_t numMaintenances;
+    double salary; /** per hour for service providers, per month for contracted employees */
+    double hoursWorked;
+    uint32_t numRefs;
+    uint32_t firstRef; /** index in the references section of the ids of the maintenances scheduled, for service providers, or of the NIFs of the clients, for contracted employees */
+    SnapshotString name;
+};
+
+/** kinds of segment, in the order they are loaded */
+enum SnapshotSegmentKind {
+    SEGMENT_MAINTENANCES, SEGMENT_LIFTS, SEGMENT_CLIENTS, SEGMENT_EMPLOYEES, SEGMENT_NUMKINDS
+};
+
+struct SnapshotSegment {
+    uint32_t kind; /** a SnapshotSegmentKind */
+    uint32_t number;
+    uint64_t generation; /** save that wrote the segment, part of its file name so a save never overwrites a file in use */
+};
+
+enum SnapshotSection {
+    SNAPSHOT_LIFTS, SNAPSHOT_MOVECOLUMNS, SNAPSHOT_MAINTENANCES, SNAPSHOT_CLIENTS, SNAPSHOT_EMPLOYEES, SNAPSHOT_REFS,
+    SNAPSHOT_STRINGS, SNAPSHOT_SEGMENTS, SNAPSHOT_NUMSECTIONS
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t journalSequence; /** sequence number of the last journal entry whose mutation is in the snapshot */
+    uint64_t generation; /** number of the save that wrote the file */
+    uint64_t offset[SNAPSHOT_NUMSECTIONS]; /** from the start of the file, multiple of 8 */
+    uint64_t count[SNAPSHOT_NUMSECTIONS]; /** number of records (characters for the strings section) */
+};
+
+/**
+ * @class MappedFile
+ * Read only view of a whole file mapped in memory
+ */
+class MappedFile {
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * Maps the file with the given path, unmapping the previous one if there was one
+     * @return false if the file could not be opened or mapped
+     */
+    bool open(const string &path);
+
+    void close();
+
+    const char *data() const;
+
+    size_t size() const;
+
+private:
+    const char *base;
+    size_t length;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int fd;
+#endif
+};
+
+class SnapshotReader;
+
+/**
+ * @class SnapshotWriter
+ * Gathers the records of a snapshot and writes them to a file
+ */
+class SnapshotWriter {
+public:
+    uint64_t journalSequence;
+    uint64_t generation;
+    vector<SnapshotLift> lifts;
+    vector<SnapshotMaintenance> maintenances;
+    vector<SnapshotClient> clients;
+    vector<SnapshotEmployee> employees;
+    vector<uint32_t> refs;
+    vector<SnapshotSegment> segments;
+
+    SnapshotWriter();
+
+    /**
+     * Adds the text given as parameter to the strings section
+     * @return reference to be stored in a record
+     */
+    SnapshotString addString(const string &s);
+
+    /**
+     * Adds the moves of a lift to the move columns section, as three columns one after the other: the date and time of
+     * each move, as a difference from the previous move; the floor each move started from, as a difference from the
+     * floor the previous one went to; and the floor each move went to, as a difference from where it started. Each
+     * difference is a variable length integer, a single byte for the common small ones
+     * @param lift gets the offset and length of the moves
+     */
+    void addMoves(const vector<SnapshotMove> &moves, SnapshotLift &lift);
+
+    /**
+     * Adds the moves of a lift as they are in another snapshot, without decoding them
+     * @param saved record of the lift in from
+     * @param lift gets the offset, length and number of the moves
+     */
+    void copyMoves(const SnapshotReader &from, const SnapshotLift &saved, SnapshotLift &lift);
+
+    /**
+     * Writes the snapshot to a temporary file, forces it to the disk and then puts it in place of path with
+     * replaceFile, so an interrupted save, or a power loss afterwards, never leaves a truncated snapshot behind
+     * @return false if the file could not be written or made durable
+     */
+    bool write(const string &path) const;
+
+    /**
+     * @return size in bytes of the file write() produces
+     */
+    uint64_t size() const;
+
+private:
+    string strings;
+    string moveColumns;
+
+    uint64_t layout(SnapshotHeader &header) const;
+};
+
+/**
+ * @class SnapshotMoveCursor
+ * Reads the moves of a lift from the move columns, one at a time, without building them all
+ */
+class SnapshotMoveCursor {
+public:
+    /**
+     * @param data start of the lift's moves in the move columns section
+     * @param length bytes taken by the lift's moves
+     * @param count number of moves of the lift
+     */
+    SnapshotMoveCursor(const char *data, uint32_t length, uint32_t count);
+
+    /**
+     * Reads the next move
+     * @return false if there are no more moves, or the columns are damaged
+     */
+    bool next(SnapshotMove &move);
+
+private:
+    const char *stamps, *froms, *tos, *end;
+    uint32_t left;
+    uint64_t stamp;
+    int64_t to;
+};
+
+/**
+ * @class SnapshotReader
+ * Maps a snapshot and gives access to its records where they are, after checking that every index and string in it
+ * is inside the file
+ */
+class SnapshotReader {
+public:
+    SnapshotReader();
+
+    /**
+     * @return false if there is no snapshot at path, or it is not valid or was written by another version
+     */
+    bool open(const string &path);
+
+    /**
+     * @return number of records in the section, 0 while no snapshot is open
+     */
+    uint64_t count(SnapshotSection section) const;
+
+    /**
+     * @return sequence number of the last journal entry whose mutation is in the snapshot
+     */
+    uint64_t getJournalSequence() const;
+
+    uint64_t getGeneration() const;
+
+    const SnapshotLift *lifts() const;
+
+    /**
+     * @return cursor over the moves of a lift of this snapshot
+     */
+    SnapshotMoveCursor moves(const SnapshotLift &lift) const;
+
+    /**
+     * @return start of the move columns section, where the movesOffset of each lift counts from
+     */
+    const char *moveColumns() const;
+
+    const SnapshotMaintenance *maintenances() const;
+
+    const SnapshotClient *clients() const;
+
+    const SnapshotEmployee *employees() const;
+
+    const uint32_t *refs() const;
+
+    const SnapshotSegment *segments() const;
+
+    string str(const SnapshotString &s) const;
+
+private:
+    MappedFile file;
+    const SnapshotHeader *header;
+
+    const char *section(SnapshotSection s) const;
+
+    bool validate() const;
+};
+
+/**
+ * @return last modification time of the file with the given path, in the finest unit the platform keeps, -1 if it
+ * does not exist
+ */
+long long fileModificationTime(const string &path);
+
+/**
+ * Writes what is buffered for the file and waits until all of it is on the disk
+ * @return false if it could not be written
+ */
+bool syncFile(FILE *f);
+
+/**
+ * Puts the file at from in place of the one at to, in one step that survives a crash: afterwards the path to has
+ * either the old file or the new one, never none or part of one. Returns once the change is on the disk
+ * @return false if the file could not be moved, or the move could not be made durable
+ */
+bool replaceFile(const string &from, const string &to);
+
+/**
+ * @return path of the file of a segment listed in the snapshot with the given path
+ */
+string segmentPath(const string &snapshotPath, const SnapshotSegment &segment);
+
+#endif
@@ -355,7 +355,10 @@ void User_interface::office() {
             }
             try {
                 pitch->searchEmployee(nif);
-                pitch->removeEmployee(nif);
+                vector<Maintenance *> unplaced = pitch->removeEmployee(nif);
+                for (vector<Maintenance *>::iterator it = unplaced.begin(); it != unplaced.end(); it++)
+                    cout << "No service provider is available for the maintenance of lift " << (*it)->getLiftCode()
+                         << " on " << (*it)->getMaintenanceDate() << " at " << (*it)->getMaintenanceSchedule() << ".\n";
             }
             catch (EmployeeDoesNotExist &e) {
                 cout << e.what() << endl;
@@ -794,9 +797,7 @@ void User_interface::client(Entrepreneur *client) {
                     failedInput = input(eval, possibilities);
                 }
                 ContractedEmployee *ce = pitch->getEmployeeAssociatedToEntrepreneur(client);
-                pitch->temporarilyRemoveEmployee(ce->getNif());
-                ce->review(eval);
-                pitch->addContractedEmployee(ce);
+                pitch->reviewContractedEmployee(ce, eval);
                 cout << "\nThank you for giving us your opinion.\n";
 
                 break;
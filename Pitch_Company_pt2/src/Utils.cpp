@@ -1,8 +1,13 @@
 #include "Utils.h"
-#include <sstream>
+#include <iostream>
 
 using namespace std;
 
+/**
+ * Reads three unsigned integers separated by single characters, the format shared by dates and times
+ */
+static bool parseTriple(const char *&first, const char *last, unsigned int &a, unsigned int &b, unsigned int &c);
+
 Date::Date() {
     day = 0;
     month = 0;
@@ -22,35 +27,18 @@ Date::Date(const Date &toCopy) {
 }
 
 Date::Date(string dat) {
-    char trash;
+    const char *first = dat.data();
     unsigned int d, m, y;
-    istringstream dateStrStream(dat);
-    bool validFormat = false;
-
-    if (dateStrStream >> d >> trash >> m >> trash >> y) {
-        validFormat = true;
-        if (m > 12 || m < 1) {
-            throw InvalidDate(d, m, y);
-        } else if ((m == 1 || m == 3 || m == 5 || m == 7 || m == 8 || m == 10 || m == 12) && (d < 1 || d > 31)) {
-            throw InvalidDate(d, m, y);
-        } else if ((m == 4 || m == 6 || m == 9 || m == 11) && (d < 1 || d > 31)) {
-            throw InvalidDate(d, m, y);
-        } else if (((y % 4 == 0) && (y % 100 != 0) || ((y % 4 == 0) && (y % 100 == 0) && (y % 400 == 0)))) {
-            //leap year
-            if ((m == 2) && (d < 1 || d > 29)) {
-                throw InvalidDate(d, m, y);
-            }
-        } else if ((m == 2) && (d < 1 || d > 28)) {
-            throw InvalidDate(d, m, y);
-        }
-        this->year = y;
-        this->month = m;
-        this->day = d;
-    } else {
-        validFormat = false;
+    if (!parseTriple(first, first + dat.size(), d, m, y)) {
         cout << "Not a valid Date format.\n";
-        throw InvalidDate(d,m,y);
+        throw InvalidDate(0, 0, 0);
     }
+    if (!validDate(d, m, y)) {
+        throw InvalidDate(d, m, y);
+    }
+    this->year = y;
+    this->month = m;
+    this->day = d;
 }
 
 Date &Date::operator=(const Date &toAssign) {
@@ -60,15 +48,60 @@ Date &Date::operator=(const Date &toAssign) {
     return *this;
 }
 
+int Date::toDays() const {
+    return daysFromCivil(year, month, day);
+}
+
+Date Date::fromDays(int days) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned int doe = (unsigned int) (days - era * 146097);
+    const unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned int mp = (5 * doy + 2) / 153;
+    const unsigned int d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned int m = mp < 10 ? mp + 3 : mp - 9;
+    return Date(d, m, (int) yoe + era * 400 + (m <= 2));
+}
+
+unsigned int Date::toKey() const {
+    return (year << 9) | (month << 5) | day; //day takes 5 bits and month 4
+}
+
+Date Date::fromKey(unsigned int key) {
+    return Date(key & 31, (key >> 5) & 15, key >> 9);
+}
+
+Date Date::operator+(int days) const {
+    return fromDays(toDays() + days);
+}
+
+int Date::operator-(const Date &d) const {
+    return toDays() - d.toDays();
+}
+
 bool Date::operator<(const Date &d) const {
-    if (year < d.year) return true;
-    else if (year == d.year && month < d.month) return true;
-    else if (year == d.year && month == d.month && day < d.day) return true;
-    else return false;
+    return toKey() < d.toKey();
+}
+
+bool Date::operator<=(const Date &d) const {
+    return toKey() <= d.toKey();
+}
+
+bool Date::operator>(const Date &d) const {
+    return toKey() > d.toKey();
+}
+
+bool Date::operator>=(const Date &d) const {
+    return toKey() >= d.toKey();
 }
 
 bool Date::operator==(const Date &d) const {
-    return (year == d.year && month == d.month && day == d.day);
+    return toKey() == d.toKey();
+}
+
+bool Date::operator!=(const Date &d) const {
+    return toKey() != d.toKey();
 }
 
 ostream &operator<<(ostream &out, Date d) {
@@ -90,24 +123,18 @@ Time::Time(unsigned int h, unsigned int m, unsigned int s) {
 }
 
 Time::Time(string t) {
-    char trash;
+    const char *first = t.data();
     unsigned int h, m, s;
-    istringstream timeStrStream(t);
-    bool validFormat = false;
-    if (timeStrStream >> h >> trash >> m >> trash >> s) {
-        validFormat = true;
-        if (h < 0 || h > 24 || m < 0 || m > 59 || s < 0 || s > 59) {
-            throw InvalidTime(h, m, s);
-        }
-
-        this->hours = h;
-        this->minutes = m;
-        this->seconds = s;
-    } else {
-        validFormat = false;
+    if (!parseTriple(first, first + t.size(), h, m, s)) {
         cout << "Not a valid Time format.\n";
-        throw InvalidTime(h,m,s);
+        throw InvalidTime(0, 0, 0);
     }
+    if (!validTime(h, m, s)) {
+        throw InvalidTime(h, m, s);
+    }
+    this->hours = h;
+    this->minutes = m;
+    this->seconds = s;
 }
 
 Time::Time(const Time &toCopy) {
@@ -123,55 +150,141 @@ Time &Time::operator=(const Time &toAssign) {
     return *this;
 }
 
-Time &Time::operator+(const Time &t2) {
-    seconds += t2.seconds;
-    minutes = minutes + (seconds / 60);
-    hours = hours + (minutes / 60);
-    minutes = minutes % 60;
-    seconds = seconds % 60;
-    return *this;
+unsigned int Time::toSeconds() const {
+    return secondsOfDay(hours, minutes, seconds);
+}
+
+Time Time::fromSeconds(unsigned int s) {
+    return Time(s / 3600, (s / 60) % 60, s % 60);
+}
+
+Time Time::operator+(const Time &t2) const {
+    return fromSeconds(toSeconds() + t2.toSeconds());
 }
 
-Time &operator*(Time &t, int x) {
-    Time aux = t;
-    for (int i = 0; i < x - 1; i++)
-        t = t + aux;
-    return t;
+Time Time::operator-(const Time &t2) const {
+    unsigned int s1 = toSeconds(), s2 = t2.toSeconds();
+    return fromSeconds(s1 > s2 ? s1 - s2 : 0);
+}
+
+Time operator*(const Time &t, int x) {
+    return Time::fromSeconds(x > 0 ? t.toSeconds() * x : 0);
 }
 
 bool Time::operator<(const Time &t) const {
-    if (hours < t.hours) return true;
-    else if (hours == t.hours && minutes < t.minutes) return true;
-    else if (hours == t.hours && minutes == t.minutes && seconds < t.seconds) return true;
-    else return false;
+    return toSeconds() < t.toSeconds();
 }
 
 bool Time::operator>(const Time &t) const {
-    if (hours > t.hours) return true;
-    else if (hours == t.hours && minutes > t.minutes) return true;
-    else if (hours == t.hours && minutes == t.minutes && seconds > t.seconds) return true;
-    else return false;
+    return toSeconds() > t.toSeconds();
 }
 
 bool Time::operator==(const Time &t) const {
-    return (hours == t.hours && minutes == t.minutes && seconds == t.seconds);
+    return toSeconds() == t.toSeconds();
+}
+
+bool Time::operator!=(const Time &t) const {
+    return toSeconds() != t.toSeconds();
 }
 
 bool Time::operator<=(const Time &t) const {
-    if (hours <= t.hours) return true;
-    else if (hours == t.hours && minutes <= t.minutes) return true;
-    else if (hours == t.hours && minutes == t.minutes && seconds <= t.seconds) return true;
-    else return false;
+    return toSeconds() <= t.toSeconds();
 }
 
 bool Time::operator>=(const Time &t) const {
-    if (hours >= t.hours) return true;
-    else if (hours == t.hours && minutes >= t.minutes) return true;
-    else if (hours == t.hours && minutes == t.minutes && seconds >= t.seconds) return true;
-    else return false;
+    return toSeconds() >= t.toSeconds();
 }
 
 ostream &operator<<(ostream &out, Time t) {
     out << t.hours << ":" << t.minutes << ":" << t.seconds;
     return out;
 }
+
+Timestamp toTimestamp(const Date &d, const Time &t) {
+    return (Timestamp) d.toDays() * SECONDSPERDAY + t.toSeconds();
+}
+
+bool validDate(unsigned int d, unsigned int m, unsigned int y) {
+    if (m > 12 || m < 1) {
+        return false;
+    } else if ((m == 1 || m == 3 || m == 5 || m == 7 || m == 8 || m == 10 || m == 12) && (d < 1 || d > 31)) {
+        return false;
+    } else if ((m == 4 || m == 6 || m == 9 || m == 11) && (d < 1 || d > 31)) {
+        return false;
+    } else if (((y % 4 == 0) && (y % 100 != 0) || ((y % 4 == 0) && (y % 100 == 0) && (y % 400 == 0)))) {
+        //leap year
+        if ((m == 2) && (d < 1 || d > 29)) {
+            return false;
+        }
+    } else if ((m == 2) && (d < 1 || d > 28)) {
+        return false;
+    }
+    return true;
+}
+
+bool validTime(unsigned int h, unsigned int m, unsigned int s) {
+    return !(h > 24 || m > 59 || s > 59);
+}
+
+static void skipBlanks(const char *&first, const char *last) {
+    while (first != last && (*first == ' ' || *first == '\t' || *first == '\r'))
+        first++;
+}
+
+bool parseUnsigned(const char *&first, const char *last, unsigned int &x) {
+    skipBlanks(first, last);
+    if (first == last || *first < '0' || *first > '9')
+        return false;
+    x = 0;
+    while (first != last && *first >= '0' && *first <= '9')
+        x = x * 10 + (*first++ - '0');
+    return true;
+}
+
+bool parseInt(const char *&first, const char *last, int &x) {
+    skipBlanks(first, last);
+    const char *p = first;
+    bool negative = p != last && *p == '-';
+    if (negative)
+        p++;
+    unsigned int abs;
+    if (p == last || *p < '0' || *p > '9' || !parseUnsigned(p, last, abs))
+        return false;
+    x = negative ? -(int) abs : (int) abs;
+    first = p;
+    return true;
+}
+
+static bool parseTriple(const char *&first, const char *last, unsigned int &a, unsigned int &b, unsigned int &c) {
+    const char *p = first;
+    if (!parseUnsigned(p, last, a) || p == last)
+        return false;
+    p++;
+    if (!parseUnsigned(p, last, b) || p == last)
+        return false;
+    p++;
+    if (!parseUnsigned(p, last, c))
+        return false;
+    first = p;
+    return true;
+}
+
+ParseResult parseDate(const char *&first, const char *last, Date &d) {
+    unsigned int day, month, year;
+    if (!parseTriple(first, last, day, month, year))
+        return PARSE_BAD_FORMAT;
+    d.day = day;
+    d.month = month;
+    d.year = year;
+    return validDate(day, month, year) ? PARSE_OK : PARSE_BAD_VALUE;
+}
+
+ParseResult parseTime(const char *&first, const char *last, Time &t) {
+    unsigned int h, m, s;
+    if (!parseTriple(first, last, h, m, s))
+        return PARSE_BAD_FORMAT;
+    t.hours = h;
+    t.minutes = m;
+    t.seconds = s;
+    return validTime(h, m, s) ? PARSE_OK : PARSE_BAD_VALUE;
+}
@@ -8,6 +8,33 @@
 
 using namespace std;
 
+#define SECONDSPERDAY 86400
+
+/**
+ * Moment in time as a single integer, seconds since 1/1/1970 at 0:0:0, so that dates with a schedule can be compared,
+ * subtracted and used as a sort key with one integer operation
+ */
+typedef long long Timestamp;
+
+/**
+ * @return number of days from 1/1/1970 to the given day of the proleptic gregorian calendar (negative if before)
+ */
+constexpr int daysFromCivil(int y, unsigned int m, unsigned int d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned int yoe = (unsigned int) (y - era * 400);
+    const unsigned int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int) doe - 719468;
+}
+
+/**
+ * @return number of seconds since 0:0:0
+ */
+constexpr unsigned int secondsOfDay(unsigned int h, unsigned int m, unsigned int s) {
+    return h * 3600 + m * 60 + s;
+}
+
 /**
  * @class Date
  */
@@ -29,9 +56,49 @@ public:
 
     Date &operator=(const Date &toAssign);
 
+    /**
+     * @return number of days since 1/1/1970
+     */
+    int toDays() const;
+
+    /**
+     * @param days number of days since 1/1/1970
+     * @return the date that many days after 1/1/1970
+     */
+    static Date fromDays(int days);
+
+    /**
+     * @return year, month and day packed in a single integer that sorts like the date itself
+     */
+    unsigned int toKey() const;
+
+    /**
+     * @param key value returned by toKey
+     * @return the date packed in key
+     */
+    static Date fromKey(unsigned int key);
+
+    /**
+     * @return date the given number of days after this one
+     */
+    Date operator+(int days) const;
+
+    /**
+     * @return number of days from d to this date
+     */
+    int operator-(const Date &d) const;
+
     bool operator<(const Date &d) const;
 
+    bool operator<=(const Date &d) const;
+
+    bool operator>(const Date &d) const;
+
+    bool operator>=(const Date &d) const;
+
     bool operator==(const Date &d) const;
+
+    bool operator!=(const Date &d) const;
 };
 
 /** output operator for objects of the class Date */
@@ -58,7 +125,23 @@ public:
 
     Time &operator=(const Time &toAssign);
 
-    Time &operator+(const Time &t2);
+    /**
+     * @return number of seconds since 0:0:0
+     */
+    unsigned int toSeconds() const;
+
+    /**
+     * @param s number of seconds since 0:0:0
+     * @return the time that many seconds after 0:0:0 (hours are not wrapped around a day)
+     */
+    static Time fromSeconds(unsigned int s);
+
+    Time operator+(const Time &t2) const;
+
+    /**
+     * @return time elapsed from t2 to this time, 0:0:0 if t2 is later
+     */
+    Time operator-(const Time &t2) const;
 
     bool operator<(const Time &t) const;
 
@@ -69,9 +152,62 @@ public:
     bool operator>=(const Time &t)const;
 
     bool operator==(const Time &t) const;
+
+    bool operator!=(const Time &t) const;
+};
+
+/**
+ * @return duration t repeated x times, 0:0:0 if x is not positive
+ */
+Time operator*(const Time &t, int x);
+
+/**
+ * @return the moment the given time of the given day corresponds to
+ */
+Timestamp toTimestamp(const Date &d, const Time &t);
+
+/** outcome of the parsing functions below */
+enum ParseResult {
+    PARSE_OK, /** the value was read and is valid */
+    PARSE_BAD_FORMAT, /** the text does not have the expected format */
+    PARSE_BAD_VALUE /** the text has the expected format but the value read is not valid */
 };
 
-Time &operator*(Time &t, int x);
+/**
+ * @return true if d/m/y is a valid date, by the same rules Date(string) uses
+ */
+bool validDate(unsigned int d, unsigned int m, unsigned int y);
+
+/**
+ * @return true if h:m:s is a valid time, by the same rules Time(string) uses
+ */
+bool validTime(unsigned int h, unsigned int m, unsigned int s);
+
+/**
+ * Reads an unsigned integer from the characters in [first, last), skipping leading blanks, without allocating
+ * @param first position to read from, moved past the number
+ * @return false if there was no number to read
+ */
+bool parseUnsigned(const char *&first, const char *last, unsigned int &x);
+
+/**
+ * Same as parseUnsigned, accepting a leading minus sign
+ */
+bool parseInt(const char *&first, const char *last, int &x);
+
+/**
+ * Reads a date with format day/month/year (any single character is accepted as separator) from the characters in
+ * [first, last), skipping leading blanks, without allocating
+ * @param first position to read from, moved past the date
+ * @param d date read, left unchanged if the result is PARSE_BAD_FORMAT
+ */
+ParseResult parseDate(const char *&first, const char *last, Date &d);
+
+/**
+ * Reads a time with format hours:minutes:seconds the same way parseDate reads a date
+ * @param t time read, left unchanged if the result is PARSE_BAD_FORMAT
+ */
+ParseResult parseTime(const char *&first, const char *last, Time &t);
 
 /** output operator for objects of the class Time */
 ostream &operator<<(ostream &out, Time t);
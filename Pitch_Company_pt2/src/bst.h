@@ -3,7 +3,9 @@
 
 #include <iostream>
 #include <stack>
+#include <vector>
 #include <queue>
+#include <utility>
 
 using namespace std;
 
@@ -30,9 +32,10 @@ class BinaryNode {
     Comparable element;
     BinaryNode *left;
     BinaryNode *right;
+    int height; /** height of the subtree rooted at this node, a leaf has height 1 */
 
-    BinaryNode(const Comparable &theElement, BinaryNode *lt, BinaryNode *rt)
-            : element(theElement), left(lt), right(rt) {}
+    BinaryNode(const Comparable &theElement, BinaryNode *lt, BinaryNode *rt, int h = 1)
+            : element(theElement), left(lt), right(rt), height(h) {}
 
     friend class BST<Comparable>;
 
@@ -47,6 +50,11 @@ class BinaryNode {
     friend class iteratorBST<Comparable>;
 };
 
+/**
+ * @class BST
+ * Binary search tree kept balanced as an AVL tree, so insert, remove and find are O(log n) even when the elements
+ * are inserted already sorted. Every operation is iterative, so the tree depth never reaches the call stack.
+ */
 template<class Comparable>
 class BST {
 public:
@@ -72,21 +80,46 @@ public:
 
     bool remove(const Comparable &x);
 
+    /**
+     * Replaces the elements of the tree by the ones given, building a perfectly balanced tree in O(n); an element
+     * equal to the one before it is skipped, as insert would
+     * @param sorted elements in increasing order
+     */
+    void buildSorted(const vector<Comparable> &sorted);
+
     const BST &operator=(const BST &rhs);
 
     iteratorBST<Comparable> begin() const;
 
     iteratorBST<Comparable> end() const;
 
+    /**
+     * @return in-order iterator positioned at the first element that is not less than x
+     */
+    BSTItrIn<Comparable> lowerBound(const Comparable &x) const;
+
+    /**
+     * @return in-order iterator positioned at the first element greater than x
+     */
+    BSTItrIn<Comparable> upperBound(const Comparable &x) const;
+
 private:
     BinaryNode<Comparable> *root;
     const Comparable ITEM_NOT_FOUND;
 
     const Comparable &elementAt(BinaryNode<Comparable> *t) const;
 
-    bool insert(const Comparable &x, BinaryNode<Comparable> *&t) const;
+    static int height(BinaryNode<Comparable> *t);
 
-    bool remove(const Comparable &x, BinaryNode<Comparable> *&t) const;
+    static void updateHeight(BinaryNode<Comparable> *t);
+
+    static void rotateLeft(BinaryNode<Comparable> *&t);
+
+    static void rotateRight(BinaryNode<Comparable> *&t);
+
+    static void balance(BinaryNode<Comparable> *&t);
+
+    static void rebalancePath(stack<BinaryNode<Comparable> **> &path);
 
     BinaryNode<Comparable> *findMin(BinaryNode<Comparable> *t) const;
 
@@ -130,12 +163,58 @@ BST<Comparable>::~BST() {
 
 template<class Comparable>
 bool BST<Comparable>::insert(const Comparable &x) {
-    return insert(x, root);
+    stack<BinaryNode<Comparable> **> path; //links followed from the root, rebalanced bottom-up afterwards
+    BinaryNode<Comparable> **t = &root;
+    while (*t != NULL) {
+        path.push(t);
+        if (x < (*t)->element)
+            t = &(*t)->left;
+        else if ((*t)->element < x)
+            t = &(*t)->right;
+        else
+            return false;  // Duplicate; do nothing
+    }
+    *t = new BinaryNode<Comparable>(x, NULL, NULL);
+    rebalancePath(path);
+    return true;
 }
 
 template<class Comparable>
 bool BST<Comparable>::remove(const Comparable &x) {
-    return remove(x, root);
+    stack<BinaryNode<Comparable> **> path;
+    BinaryNode<Comparable> **t = &root;
+    while (*t != NULL) {
+        if (x < (*t)->element) {
+            path.push(t);
+            t = &(*t)->left;
+        } else if ((*t)->element < x) {
+            path.push(t);
+            t = &(*t)->right;
+        } else
+            break;
+    }
+    if (*t == NULL)
+        return false;   // Item not found; do nothing
+
+    BinaryNode<Comparable> *node = *t;
+    if (node->left != NULL && node->right != NULL) { // Two children
+        //the node takes the element of its successor, which is then unlinked from the right subtree
+        path.push(t);
+        BinaryNode<Comparable> **succ = &node->right;
+        while ((*succ)->left != NULL) {
+            path.push(succ);
+            succ = &(*succ)->left;
+        }
+        BinaryNode<Comparable> *oldNode = *succ;
+        node->element = oldNode->element;
+        *succ = oldNode->right;
+        delete oldNode;
+    } else {
+        *t = (node->left != NULL) ? node->left : node->right;
+        delete node;
+    }
+    rebalancePath(path);
+    return true;
 }
 
 template<class Comparable>
@@ -159,6 +238,38 @@ void BST<Comparable>::makeEmpty() {
     makeEmpty(root);
 }
 
+template<class Comparable>
+void BST<Comparable>::buildSorted(const vector<Comparable> &sorted) {
+    makeEmpty();
+    vector<const Comparable *> elements;
+    elements.reserve(sorted.size());
+    for (typename vector<Comparable>::const_iterator it = sorted.begin(); it != sorted.end(); it++)
+        if (elements.empty() || *elements.back() < *it)
+            elements.push_back(&*it);
+
+    //each range of elements becomes the subtree hanging from link, rooted at its middle element; a range of n elements
+    //is split in halves of n / 2 and n - n / 2 - 1, so its subtree has the height of the number of bits of n
+    struct Range {
+        BinaryNode<Comparable> **link;
+        size_t first, last;
+    };
+    stack<Range> ranges;
+    ranges.push({&root, 0, elements.size()});
+    while (!ranges.empty()) {
+        Range r = ranges.top();
+        ranges.pop();
+        if (r.first == r.last)
+            continue;
+        size_t middle = r.first + (r.last - r.first) / 2;
+        int h = 0;
+        for (size_t n = r.last - r.first; n != 0; n >>= 1)
+            h++;
+        *r.link = new BinaryNode<Comparable>(*elements[middle], NULL, NULL, h);
+        ranges.push({&(*r.link)->left, r.first, middle});
+        ranges.push({&(*r.link)->right, middle + 1, r.last});
+    }
+}
+
 template<class Comparable>
 bool BST<Comparable>::isEmpty() const {
     return root == NULL;
@@ -199,6 +310,37 @@ iteratorBST<Comparable> BST<Comparable>::end() const {
     return it;
 }
 
+//the stack left by descending towards x, keeping only the nodes where the descent went left, is exactly the state
+//of an in-order traversal about to visit the bound
+template<class Comparable>
+BSTItrIn<Comparable> BST<Comparable>::lowerBound(const Comparable &x) const {
+    BSTItrIn<Comparable> it;
+    BinaryNode<Comparable> *t = root;
+    while (t != NULL) {
+        if (t->element < x)
+            t = t->right;
+        else {
+            it.itrStack.push(t);
+            t = t->left;
+        }
+    }
+    return it;
+}
+
+template<class Comparable>
+BSTItrIn<Comparable> BST<Comparable>::upperBound(const Comparable &x) const {
+    BSTItrIn<Comparable> it;
+    BinaryNode<Comparable> *t = root;
+    while (t != NULL) {
+        if (x < t->element) {
+            it.itrStack.push(t);
+            t = t->left;
+        } else
+            t = t->right;
+    }
+    return it;
+}
+
 
 // private methods
 
@@ -213,48 +355,72 @@ elementAt(BinaryNode<Comparable> *t) const {
 
 
 template<class Comparable>
-bool BST<Comparable>::
-insert(const Comparable &x, BinaryNode<Comparable> *&t) const {
-    if (t == NULL) {
-        t = new BinaryNode<Comparable>(x, NULL, NULL);
-        return true;
-    } else if (x < t->element)
-        return insert(x, t->left);
-    else if (t->element < x)
-        return insert(x, t->right);
-    else
-        return false;  // Duplicate; do nothing
+int BST<Comparable>::height(BinaryNode<Comparable> *t) {
+    return t == NULL ? 0 : t->height;
 }
 
 template<class Comparable>
-bool BST<Comparable>::
-remove(const Comparable &x, BinaryNode<Comparable> *&t) const {
-    if (t == NULL)
-        return false;   // Item not found; do nothing
-    if (x < t->element)
-        return remove(x, t->left);
-    else if (t->element < x)
-        return remove(x, t->right);
-    else if (t->left != NULL && t->right != NULL) // Two children
-    {
-        t->element = findMin(t->right)->element;
-        return remove(t->element, t->right);
-    } else {
-        BinaryNode<Comparable> *oldNode = t;
-        t = (t->left != NULL) ? t->left : t->right;
-        delete oldNode;
-        return true;
+void BST<Comparable>::updateHeight(BinaryNode<Comparable> *t) {
+    int hl = height(t->left), hr = height(t->right);
+    t->height = 1 + (hl > hr ? hl : hr);
+}
+
+template<class Comparable>
+void BST<Comparable>::rotateLeft(BinaryNode<Comparable> *&t) {
+    BinaryNode<Comparable> *r = t->right;
+    t->right = r->left;
+    r->left = t;
+    updateHeight(t);
+    updateHeight(r);
+    t = r;
+}
+
+template<class Comparable>
+void BST<Comparable>::rotateRight(BinaryNode<Comparable> *&t) {
+    BinaryNode<Comparable> *l = t->left;
+    t->left = l->right;
+    l->right = t;
+    updateHeight(t);
+    updateHeight(l);
+    t = l;
+}
+
+/**
+ * Internal method that restores the AVL condition on t, assuming both its subtrees already satisfy it.
+ */
+template<class Comparable>
+void BST<Comparable>::balance(BinaryNode<Comparable> *&t) {
+    updateHeight(t);
+    int factor = height(t->left) - height(t->right);
+    if (factor > 1) {
+        if (height(t->left->left) < height(t->left->right))
+            rotateLeft(t->left);
+        rotateRight(t);
+    } else if (factor < -1) {
+        if (height(t->right->right) < height(t->right->left))
+            rotateRight(t->right);
+        rotateLeft(t);
+    }
+}
+
+/**
+ * Internal method that rebalances, from the deepest to the root, every link of the path followed by insert or remove.
+ */
+template<class Comparable>
+void BST<Comparable>::rebalancePath(stack<BinaryNode<Comparable> **> &path) {
+    while (!path.empty()) {
+        balance(*path.top());
+        path.pop();
     }
 }
 
 template<class Comparable>
 BinaryNode<Comparable> *
 BST<Comparable>::findMin(BinaryNode<Comparable> *t) const {
-    if (t == NULL)
-        return NULL;
-    if (t->left == NULL)
-        return t;
-    return findMin(t->left);
+    if (t != NULL)
+        while (t->left != NULL)
+            t = t->left;
+    return t;
 }
 
 
@@ -271,32 +437,16 @@ template<class Comparable>
 BinaryNode<Comparable> *
 BST<Comparable>::
 find(const Comparable &x, BinaryNode<Comparable> *t) const {
-    if (t == NULL)
-        return NULL;
-    else if (x < t->element)
-        return find(x, t->left);
-    else if (t->element < x)
-        return find(x, t->right);
-    else
-        return t;    // Match
-}
-/****** NONRECURSIVE VERSION*************************
-        template <class Comparable>
-        BinaryNode<Comparable> *
-        BST<Comparable>::
-        find( const Comparable & x, BinaryNode<Comparable> *t ) const
-        {
-            while( t != NULL )
-                if( x < t->element )
-                    t = t->left;
-                else if( t->element < x )
-                    t = t->right;
-                else
-                    return t;    // Match
-
-            return NULL;   // No match
-        }
-*****************************************************/
+    while (t != NULL)
+        if (x < t->element)
+            t = t->left;
+        else if (t->element < x)
+            t = t->right;
+        else
+            return t;    // Match
+
+    return NULL;   // No match
+}
 
 /**
  * Internal method to make subtree empty.
@@ -304,30 +454,50 @@ find(const Comparable &x, BinaryNode<Comparable> *t) const {
 template<class Comparable>
 void BST<Comparable>::
 makeEmpty(BinaryNode<Comparable> *&t) const {
-    if (t != NULL) {
-        makeEmpty(t->left);
-        makeEmpty(t->right);
-        delete t;
+    stack<BinaryNode<Comparable> *> toDelete;
+    if (t != NULL)
+        toDelete.push(t);
+    while (!toDelete.empty()) {
+        BinaryNode<Comparable> *n = toDelete.top();
+        toDelete.pop();
+        if (n->left != NULL) toDelete.push(n->left);
+        if (n->right != NULL) toDelete.push(n->right);
+        delete n;
     }
     t = NULL;
 }
 
 template<class Comparable>
 void BST<Comparable>::printTree(BinaryNode<Comparable> *t) const {
-    if (t != NULL) {
-        printTree(t->left);
+    stack<BinaryNode<Comparable> *> itrStack;
+    while (t != NULL || !itrStack.empty()) {
+        while (t != NULL) {
+            itrStack.push(t);
+            t = t->left;
+        }
+        t = itrStack.top();
+        itrStack.pop();
         cout << t->element << endl;
-        printTree(t->right);
+        t = t->right;
     }
 }
 
 template<class Comparable>
 BinaryNode<Comparable> *
 BST<Comparable>::clone(BinaryNode<Comparable> *t) const {
-    if (t == NULL)
-        return NULL;
-    else
-        return new BinaryNode<Comparable>(t->element, clone(t->left), clone(t->right));
+    BinaryNode<Comparable> *copy = NULL;
+    stack<pair<BinaryNode<Comparable> *, BinaryNode<Comparable> **> > toCopy; //node to copy, link where its copy goes
+    if (t != NULL)
+        toCopy.push(make_pair(t, &copy));
+    while (!toCopy.empty()) {
+        BinaryNode<Comparable> *n = toCopy.top().first;
+        BinaryNode<Comparable> **link = toCopy.top().second;
+        toCopy.pop();
+        *link = new BinaryNode<Comparable>(n->element, NULL, NULL, n->height);
+        if (n->left != NULL) toCopy.push(make_pair(n->left, &(*link)->left));
+        if (n->right != NULL) toCopy.push(make_pair(n->right, &(*link)->right));
+    }
+    return copy;
 }
 
 
@@ -448,7 +618,11 @@ public:
 private:
     stack<BinaryNode<Comparable> *> itrStack;
 
+    BSTItrIn() {}
+
     void slideLeft(BinaryNode<Comparable> *n);
+
+    friend class BST<Comparable>;
 };
 
 template<class Comparable>
@@ -0,0 +1,57 @@
+#ifndef _CHANGES_H_
+#define _CHANGES_H_
+
+#include <list>
+#include <vector>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * @class ChangeList
+ * Members of one kind that changed since the last snapshot save, so a save only visits those. A member joins the list
+ * the first time it changes and keeps its position in it, to leave it in O(1). Members may join from several threads
+ * at once, as the ones built while the text files are read
+ */
+template<class T>
+class ChangeList {
+public:
+    typedef typename list<T *>::iterator Entry;
+
+    /**
+     * @return position of the member in the list, to leave it with remove
+     */
+    Entry add(T *member);
+
+    void remove(Entry entry);
+
+    /**
+     * Moves every member in the list to the end of changed, leaving the list empty
+     */
+    void take(vector<T *> &changed);
+
+private:
+    list<T *> members;
+    mutex guard; /** held while members is used */
+};
+
+template<class T>
+typename ChangeList<T>::Entry ChangeList<T>::add(T *member) {
+    lock_guard<mutex> lock(guard);
+    return members.insert(members.end(), member);
+}
+
+template<class T>
+void ChangeList<T>::remove(Entry entry) {
+    lock_guard<mutex> lock(guard);
+    members.erase(entry);
+}
+
+template<class T>
+void ChangeList<T>::take(vector<T *> &changed) {
+    lock_guard<mutex> lock(guard);
+    changed.insert(changed.end(), members.begin(), members.end());
+    members.clear();
+}
+
+#endif
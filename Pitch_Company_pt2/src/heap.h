@@ -0,0 +1,163 @@
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @class IndexedHeap
+ * Max-heap with the same ordering as priority_queue (top is the element no other is greater than), that also keeps
+ * the position of every element so it can be reordered or removed in O(log n) given its key.
+ * Comparable must provide operator< and getNif(), the latter being the key used by contains, update and erase.
+ */
+template<class Comparable>
+class IndexedHeap {
+public:
+    bool empty() const;
+
+    unsigned int size() const;
+
+    const Comparable &top() const;
+
+    /**
+     * Inserts x, or replaces and reorders the element with the same key if there is one already
+     */
+    void push(const Comparable &x);
+
+    void pop();
+
+    bool contains(unsigned int key) const;
+
+    /**
+     * Restores the heap order around the element with the given key after its priority has changed
+     * @return false if there is no element with that key
+     */
+    bool update(unsigned int key);
+
+    /**
+     * @return false if there is no element with that key
+     */
+    bool erase(unsigned int key);
+
+    /**
+     * @return the elements in heap order, only meant to be scanned
+     */
+    const vector<Comparable> &elements() const;
+
+private:
+    vector<Comparable> heap;
+    unordered_map<unsigned int, unsigned int> position; /** key -> index in heap */
+
+    void place(unsigned int i, const Comparable &x);
+
+    void siftUp(unsigned int i);
+
+    void siftDown(unsigned int i);
+};
+
+template<class Comparable>
+bool IndexedHeap<Comparable>::empty() const {
+    return heap.empty();
+}
+
+template<class Comparable>
+unsigned int IndexedHeap<Comparable>::size() const {
+    return heap.size();
+}
+
+template<class Comparable>
+const Comparable &IndexedHeap<Comparable>::top() const {
+    return heap.front();
+}
+
+template<class Comparable>
+void IndexedHeap<Comparable>::push(const Comparable &x) {
+    typename unordered_map<unsigned int, unsigned int>::iterator it = position.find(x.getNif());
+    if (it != position.end()) {
+        heap[it->second] = x;
+        update(x.getNif());
+        return;
+    }
+    heap.push_back(x);
+    position[x.getNif()] = heap.size() - 1;
+    siftUp(heap.size() - 1);
+}
+
+template<class Comparable>
+void IndexedHeap<Comparable>::pop() {
+    erase(heap.front().getNif());
+}
+
+template<class Comparable>
+bool IndexedHeap<Comparable>::contains(unsigned int key) const {
+    return position.find(key) != position.end();
+}
+
+template<class Comparable>
+bool IndexedHeap<Comparable>::update(unsigned int key) {
+    typename unordered_map<unsigned int, unsigned int>::iterator it = position.find(key);
+    if (it == position.end())
+        return false;
+    unsigned int i = it->second;
+    siftUp(i);
+    siftDown(position[key]);
+    return true;
+}
+
+template<class Comparable>
+bool IndexedHeap<Comparable>::erase(unsigned int key) {
+    typename unordered_map<unsigned int, unsigned int>::iterator it = position.find(key);
+    if (it == position.end())
+        return false;
+    unsigned int i = it->second;
+    position.erase(it);
+    Comparable last = heap.back();
+    heap.pop_back();
+    if (i < heap.size()) { //the removed element was not the last one, its slot is refilled with the last one
+        place(i, last);
+        siftUp(i);
+        siftDown(position[last.getNif()]);
+    }
+    return true;
+}
+
+template<class Comparable>
+const vector<Comparable> &IndexedHeap<Comparable>::elements() const {
+    return heap;
+}
+
+template<class Comparable>
+void IndexedHeap<Comparable>::place(unsigned int i, const Comparable &x) {
+    heap[i] = x;
+    position[x.getNif()] = i;
+}
+
+template<class Comparable>
+void IndexedHeap<Comparable>::siftUp(unsigned int i) {
+    Comparable x = heap[i];
+    while (i > 0 && heap[(i - 1) / 2] < x) {
+        place(i, heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    place(i, x);
+}
+
+template<class Comparable>
+void IndexedHeap<Comparable>::siftDown(unsigned int i) {
+    Comparable x = heap[i];
+    unsigned int child = 2 * i + 1;
+    while (child < heap.size()) {
+        if (child + 1 < heap.size() && heap[child] < heap[child + 1])
+            child++;
+        if (!(x < heap[child]))
+            break;
+        place(i, heap[child]);
+        i = child;
+        child = 2 * i + 1;
+    }
+    place(i, x);
+}
+
+#endif